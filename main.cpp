@@ -457,17 +457,31 @@ int splitImages(const char* cFilename)
             continue;
         }
 
-        //Decompress WFLZ data
-        uint32_t* chunk = NULL;
+        //Decompress WFLZ data, chunks in parallel
+        if(dataOffset > fileSize || fileSize - dataOffset < 16)   //a ZLFW header is 16 bytes
+        {
+            cerr << "Image data of frame " << i << " is past the end of the file" << endl;
+            frameSizes[i].data = NULL;
+            frameSizes[i].th = th;
+            continue;
+        }
+        const uint32_t dataSize = fileSize - dataOffset > 0xffffffffU ? 0xffffffffU : (uint32_t)(fileSize - dataOffset);
         const uint32_t decompressedSize = wfLZ_GetDecompressedSize(&(fileData[dataOffset]));
         uint8_t* dst = (uint8_t*)malloc(decompressedSize);
-        uint32_t offset = 0;
-        int count = 0;
-        while(uint8_t* compressedBlock = wfLZ_ChunkDecompressLoop(&(fileData)[dataOffset], &chunk))
+        if(dst == NULL)
+        {
+            cerr << "Unable to allocate " << decompressedSize << " bytes for frame " << i << endl;
+            frameSizes[i].data = NULL;
+            frameSizes[i].th = th;
+            continue;
+        }
+        if(wfLZ_ChunkDecompressParallelSafe(&(fileData[dataOffset]), dataSize, dst, decompressedSize, 0) != WFLZ_OK)
         {
-            wfLZ_Decompress(compressedBlock, dst + offset);
-            const uint32_t blockSize = wfLZ_GetDecompressedSize(compressedBlock);
-            offset += blockSize;
+            cerr << "Corrupt image data in frame " << i << endl;
+            free(dst);
+            frameSizes[i].data = NULL;
+            frameSizes[i].th = th;
+            continue;
         }
 
         //Decompress image
@@ -240,7 +240,7 @@ FIBITMAP* imageFromPixels(uint8_t* imgData, uint32_t width, uint32_t height)
 	return result;
 }
 
-string extractTexture(uint8_t* fileData, TextureNode texData)
+string extractTexture(uint8_t* fileData, size_t fileSize, TextureNode texData)
 {
 	//Grab the filename
 	DataHeader sh;
@@ -252,17 +252,25 @@ string extractTexture(uint8_t* fileData, TextureNode texData)
 	DataHeader idh;
 	memcpy(&idh, &fileData[texData.imageDataOffset], sizeof(DataHeader));
 	
-	uint32_t dataOffset = texData.imageDataOffset + sizeof(DataHeader);
-	uint32_t* chunk = NULL;
+	uint64_t dataOffset = texData.imageDataOffset + sizeof(DataHeader);
+	if(dataOffset > fileSize || fileSize - dataOffset < 16)	//a ZLFW header is 16 bytes
+	{
+		cerr << "Image data of " << filename << " is past the end of the file" << endl;
+		return string();
+	}
+	const uint32_t dataSize = fileSize - dataOffset > 0xffffffffU ? 0xffffffffU : (uint32_t)(fileSize - dataOffset);
 	const uint32_t decompressedSize = wfLZ_GetDecompressedSize(&(fileData[dataOffset]));
 	uint8_t* dst = (uint8_t*)malloc(decompressedSize);
-	uint32_t offset = 0;
-	int count = 0;
-	while(uint8_t* compressedBlock = wfLZ_ChunkDecompressLoop(&(fileData)[dataOffset], &chunk))
-	{		
-		wfLZ_Decompress(compressedBlock, dst + offset);
-		const uint32_t blockSize = wfLZ_GetDecompressedSize(compressedBlock);
-		offset += blockSize;
+	if(dst == NULL)
+	{
+		cerr << "Unable to allocate " << decompressedSize << " bytes for " << filename << endl;
+		return string();
+	}
+	if(wfLZ_ChunkDecompressParallelSafe(&(fileData[dataOffset]), dataSize, dst, decompressedSize, 0) != WFLZ_OK)
+	{
+		cerr << "Corrupt image data in " << filename << endl;
+		free(dst);
+		return string();
 	}
 	
 	//Decompress squished image (Assume DXT1 for now)
@@ -492,7 +500,7 @@ void outputObj(string filename)
 	fclose(fp);
 }
 
-void readNode(uint8_t* fileData, uint64_t nodeOffset, int numTabs)
+void readNode(uint8_t* fileData, size_t fileSize, uint64_t nodeOffset, int numTabs)
 {
 	Node node;
 	memcpy(&node, &fileData[nodeOffset], sizeof(Node));
@@ -513,9 +521,10 @@ void readNode(uint8_t* fileData, uint64_t nodeOffset, int numTabs)
 			TextureNode texNode;
 			memcpy(&texNode, &fileData[nodeOffset + sizeof(Node)], sizeof(TextureNode));
 			
-			//Extract texture
-			string textureFilename = extractTexture(fileData, texNode);
-			textureFilenames[texNode.hash] = textureFilename;
+			//Extract texture, skipping it if the data is corrupt
+			string textureFilename = extractTexture(fileData, fileSize, texNode);
+			if(!textureFilename.empty())
+				textureFilenames[texNode.hash] = textureFilename;
 			break;
 		}
 		
@@ -606,7 +615,7 @@ void readNode(uint8_t* fileData, uint64_t nodeOffset, int numTabs)
 		memcpy(&offset, &fileData[node.childListOffset+i*sizeof(offsetList)], sizeof(offsetList));
 		
 		//Recurse
-		readNode(fileData, offset.offset, numTabs+1);
+		readNode(fileData, fileSize, offset.offset, numTabs+1);
 	}
 }
 
@@ -643,7 +652,7 @@ void decomp(string filename)
 	}
 	
 	//Read the root node
-	readNode(fileData, sizeof(wf3dHeader), 0);
+	readNode(fileData, fileSize, sizeof(wf3dHeader), 0);
 	
 	outputObj(filename);
 	
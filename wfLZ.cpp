@@ -9,74 +9,230 @@
 
 // TODO: tuning docs! explanations here are good but give little idea how much each variable matters
 
-// lowers the overhead imposed by compression meta-data a bit at the cost of significantly limiting the maximum match distance (beneficial if compressed data is <=4KB -- maybe make this automatic?)
-// this is not compatible with endian swapping and probably not with unaligned reads
-//#define WFLZ_SHORT_WINDOW
-
 // some of these variables are limited by the types they are stored in, be careful if tweaking
-#ifdef WFLZ_SHORT_WINDOW
-
-	// size of wfLZ_Block, can't sizeof cuz padding
-	#define WFLZ_BLOCK_SIZE         3
-
-	// no point in compressing anything smaller than the block describing it
-	#define WFLZ_MIN_MATCH_LEN      ( WFLZ_BLOCK_SIZE + 1 )
-
-	// capped by max value of wfLZ_Block::length, + WFLZ_MIN_MATCH_LEN is free, requiring no extra bits
-	#define WFLZ_MAX_MATCH_LEN      ( 0x1fU-1 ) + WFLZ_MIN_MATCH_LEN
 
-	// capped by max value of wfLZ_Block::dist
-	// WFLZ_MAX_MATCH_DIST_FAST is the distance used by CompressFast, it can be useful to set WFLZ_MAX_MATCH_DIST lower than WFLZ_MAX_MATCH_DIST_FAST to speed up Compress()
-	#define WFLZ_MAX_MATCH_DIST      0x7ffU
-	#define WFLZ_MAX_MATCH_DIST_FAST 0x7ffU
-#else
-	#define WFLZ_BLOCK_SIZE          4
-	#define WFLZ_MIN_MATCH_LEN       ( WFLZ_BLOCK_SIZE + 1 ) 
-	#define WFLZ_MAX_MATCH_LEN       ( 0xffU-1 ) + WFLZ_MIN_MATCH_LEN
-	#define WFLZ_MAX_MATCH_DIST      0xffffU
-	#define WFLZ_MAX_MATCH_DIST_FAST 0xffffU
-#endif
+// size of wfLZ_Block, can't sizeof cuz padding
+#define WFLZ_BLOCK_SIZE          4
+
+// no point in compressing anything smaller than the block describing it
+#define WFLZ_MIN_MATCH_LEN       ( WFLZ_BLOCK_SIZE + 1 )
+
+// capped by max value of wfLZ_Block::length, + WFLZ_MIN_MATCH_LEN is free, requiring no extra bits
+#define WFLZ_MAX_MATCH_LEN       ( 0xffU-1 ) + WFLZ_MIN_MATCH_LEN
+
+// capped by max value of wfLZ_Block::dist
+// WFLZ_MAX_MATCH_DIST_FAST is the distance used by WFLZ_LEVEL_FAST, WFLZ_MAX_MATCH_DIST by the other levels
+// these are the defaults and the limits for wfLZ_CompressParams::maxDist, a lower maxDist speeds up the higher levels
+#define WFLZ_MAX_MATCH_DIST      0xffffU
+#define WFLZ_MAX_MATCH_DIST_FAST 0xffffU
+
+// the same for the short blocks of WFL3 (WFLZ_BLOCKS_SHORT): an 11-bit distance and a 5-bit length share 16 bits, 3 bytes a block instead of 4
+// that lowers the overhead of the compression meta-data a bit at the cost of significantly limiting the maximum match distance and length
+#define WFLZ_SHORT_BLOCK_SIZE        3
+#define WFLZ_SHORT_MIN_MATCH_LEN     ( WFLZ_SHORT_BLOCK_SIZE + 1 )
+#define WFLZ_SHORT_MAX_MATCH_LEN     ( 0x1fU-1 ) + WFLZ_SHORT_MIN_MATCH_LEN
+#define WFLZ_SHORT_MAX_MATCH_DIST    0x7ffU
+
+// WFLZ_BLOCKS_AUTO compresses inputs up to this size with short blocks, anything bigger with the usual ones
+// the short window costs more than the smaller blocks save once a good part of the matches are further back than it reaches
+#define WFLZ_SHORT_AUTO_SIZE         0x3000U
+
+// the far blocks of WFLX (WFLZ_BLOCKS_FAR) are the usual ones, except a match further back than WFLZ_FAR_NEAR_DIST sets the top bit of the distance and
+// the block gets a 5th byte with bits 15 to 22 of it, so matches reach back 8MB and only the far ones pay for it
+// WFLZ_FAR_MATCH_DIST is the default wfLZ_CompressParams::maxDist for them, WFLZ_FAR_MAX_MATCH_DIST the limit
+// the window costs workMem: 4 bytes a position for the chains of the middle levels, 8 for the tree of WFLZ_LEVEL_MAX, 1MB back takes 4MB / 8MB
+#define WFLZ_FAR_NEAR_DIST           0x7fffU
+#define WFLZ_FAR_MATCH_DIST          0xfffffU
+#define WFLZ_FAR_MAX_MATCH_DIST      0x7fffffU
+
+// default wfLZ_CompressParams::hashBits for far blocks above WFLZ_LEVEL_FAST. A window 16 times as big puts 16 times as many positions on each
+// hash chain, and every one of them is a cache miss this far back -- incompressible data compressed 7x faster with 20 bits than with 16
+// the deep searches of levels 7 and up still slow down a lot on data with many real candidates, there's just that much more to look at
+#define WFLZ_FAR_HASH_BITS           20
 
 // capped by wfLZ_Block::numLiterals
 // this is the maximum length of uncompressible data, if this limit is reached, another block must be emitted
 // in practice, raising this helps ratio a very slight amount, but is not worth the cost of making our compression block bigger
 #define WFLZ_MAX_SEQUENTIAL_LITERALS 0xffU
 
-// number of bytes required = WFLZ_DICTSIZE*sizeof( wfLZ_DictEntry )
+// default wfLZ_CompressParams::hashBits, the dictionary has 1 << WFLZ_HASH_BITS entries
+// number of bytes required = ( 1 << WFLZ_HASH_BITS )*sizeof( wfLZ_DictEntry )
 // raising this can increase compression ratio slightly, but has a huge impact on the amount of working memory required
-// the default value (0xffffU) requires 256KB working memory
-#define WFLZ_DICT_SIZE               0xffffU
+// the default value (16) requires 256KB working memory
+// the dictionary is only cleared the first time workMem is used, see wfLZ_WorkMemBegin()
+#define WFLZ_HASH_BITS               16
+
+// Compress() only compares against earlier positions with the same hash, following a chain from the most recent one back through the window
+// this caps how many of them it looks at per input byte, raising it improves ratio a little and costs speed (0xffffU looks at every candidate, just like a full scan)
+// this is the wfLZ_CompressParams::searchDepth of WFLZ_LEVEL_COMPRESS, the lower levels look at fewer, see wfLZ_levels
+#define WFLZ_MAX_CHAIN_DEPTH         0x1000U
+
+// CompressOptimal() stops descending its match tree after visiting this many nodes for a position (the searchDepth of WFLZ_LEVEL_MAX)
+#define WFLZ_MAX_TREE_DEPTH          0x200U
+
+// default wfLZ_CompressParams::niceLen of levels 2 to 6: a match this long is taken as it is, without searching any further for a longer one
+// or checking whether the next byte starts one. data with lots of long matches is where searching costs the most and gains the least
+// the other levels default to WFLZ_MAX_MATCH_LEN, only stopping at a match that can't get any longer
+#define WFLZ_NICE_MATCH_LEN          128
+
+// Compress() only adds the last this many positions of a match of niceLen or longer to the hash chains, the ones before are in the chains
+// already at the earlier copy of the match. without this runs of one byte spend nearly all their time adding positions nobody will pick
+#define WFLZ_NICE_MATCH_INSERTS      16
+
+// CompressOptimal() plans the parse for this many bytes of input at a time (must be a power of 2), workMem grows by 36 bytes for each
+// only the part before the last WFLZ_OPTIMAL_LOOKAHEAD bytes is kept, the next plan starts over from there so paths don't get cut short at the end of a plan
+#define WFLZ_OPTIMAL_SEGMENT         0x4000U
+#define WFLZ_OPTIMAL_LOOKAHEAD       0x400U
+
+// CompressFast() starts skipping ahead after 1 << WFLZ_SKIP_TRIGGER positions in a row without a match, one more byte per step for each
+// 1 << WFLZ_SKIP_TRIGGER misses after that -- incompressible data goes by quickly, but matches that start in the skipped bytes are missed
+// lowering this speeds up data that is mostly incompressible and costs ratio on everything else
+#define WFLZ_SKIP_TRIGGER            6
+
+// ChunkCompress() samples this many runs of WFLZ_SAMPLE_RUN_SIZE bytes from each chunk to decide whether to bother compressing it,
+// see wfLZ_SampleIncompressible()
+#define WFLZ_SAMPLE_RUNS             32
+#define WFLZ_SAMPLE_RUN_SIZE         64
 
 // when using ChunkCompress() each block will be aligned to this -- makes PS3 SPU transfer convenient
 #define WFLZ_CHUNK_PAD               16
 
+// wfLZ_CompressParams::filter splits this many bytes of texture blocks at a time into planes, the decompressors copy that much to the stack to
+// put the blocks back together. Bigger groups give the matches longer planes, 4KB gets almost all of what a whole chunk would
+#define WFLZ_FILTER_GROUP            0x1000U
+
+// ChunkCompressParallel() runs its workers on std::thread, comment this out for platforms without it (SPU...) and they all run on the calling thread
+#define WFLZ_THREADS
+
+// wfLZ_CompressParams::timeLimit needs a clock (std::chrono::steady_clock), comment this out for platforms without one (SPU...) and timeLimit is ignored
+#define WFLZ_CLOCK
+
+// with a timeLimit the compressors look at the clock every this many bytes of input, so they run over it by about the time this many bytes take
+#define WFLZ_DEADLINE_CHECK          0x1000U
+
+// wfLZ_CompressParams::stats is only filled in when this is defined, without it the compressors don't count anything and cost the same as ever
+//#define WFLZ_STATS
+
+// default amount of input a stream compressor collects before compressing it into a frame, see wfLZ_StreamCompressorInit()
+// every frame costs a header and the history gets moved along after each one, so small frames cost ratio and speed
+#define WFLZ_STREAM_BLOCK_SIZE       0x40000U
+
+// Decompress() copies literals and matches this many bytes at a time while it is far enough away from the end of its buffers, then finishes byte by byte
+// picked automatically from the instruction set the compiler targets (-mavx2 gives 32, SSE2 -- any x64 build -- gives 16)
+#if defined( __AVX2__ )
+	#include <immintrin.h>
+	#define WFLZ_WILDCOPY_SIZE       32
+#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#include <emmintrin.h>
+	#define WFLZ_WILDCOPY_SIZE       16
+#else
+	#define WFLZ_WILDCOPY_SIZE       8
+#endif
+
+// on x86 Decompress() checks the CPU (cpuid) the first time it's called and copies as wide as it allows, rather than only as wide as WFLZ_WILDCOPY_SIZE
+// so a plain -O2 build still gets 32 byte AVX2 copies where there are any, and a 32-bit build without -msse2 gets SSE2 ones
+// comment this out to use WFLZ_WILDCOPY_SIZE everywhere (it does nothing when the compiler already targets AVX2, or isn't on x86)
+#define WFLZ_DISPATCH
+
+// the compressors measure matches this many bytes at a time, the first byte that differs is found with a count of trailing (leading on big endian) zeros
+// picked like WFLZ_WILDCOPY_SIZE, 8 is a 64-bit compare and 4 a 32-bit one. 1 compares byte by byte, for CPUs without unaligned loads (SPU...)
+// build with -DWFLZ_MATCH_LEN_SIZE=n to pick one, wflz_bench shows what each does to compression speed
+#ifndef WFLZ_MATCH_LEN_SIZE
+	#if WFLZ_WILDCOPY_SIZE > 8
+		#define WFLZ_MATCH_LEN_SIZE  WFLZ_WILDCOPY_SIZE
+	#elif defined( __x86_64__ ) || defined( _M_X64 ) || defined( __aarch64__ ) || defined( _M_ARM64 ) || defined( __powerpc64__ )
+		#define WFLZ_MATCH_LEN_SIZE  8
+	#else
+		#define WFLZ_MATCH_LEN_SIZE  4
+	#endif
+#endif
+
 //
 // End Config
 //
 
+#if WFLZ_MATCH_LEN_SIZE == 32 && !defined( __AVX2__ )
+	#error WFLZ_MATCH_LEN_SIZE 32 needs AVX2
+#elif WFLZ_MATCH_LEN_SIZE == 16 && WFLZ_WILDCOPY_SIZE < 16
+	#error WFLZ_MATCH_LEN_SIZE 16 needs SSE2
+#elif WFLZ_MATCH_LEN_SIZE != 32 && WFLZ_MATCH_LEN_SIZE != 16 && WFLZ_MATCH_LEN_SIZE != 8 && WFLZ_MATCH_LEN_SIZE != 4 && WFLZ_MATCH_LEN_SIZE != 1
+	#error WFLZ_MATCH_LEN_SIZE must be 1, 4, 8, 16 or 32
+#endif
+
+#if defined( WFLZ_DISPATCH ) && ( WFLZ_WILDCOPY_SIZE == 32 || !( defined( __i386__ ) || defined( __x86_64__ ) || defined( _M_IX86 ) || defined( _M_X64 ) ) )
+	#undef WFLZ_DISPATCH
+#endif
+
+#if defined( _MSC_VER ) && ( WFLZ_MATCH_LEN_SIZE != 1 || defined( WFLZ_DISPATCH ) )
+	#include <intrin.h>
+#endif
+
+// the copies Decompress() may pick from, up to 32 bytes when dispatching -- a ring, margin or lead sized for WFLZ_WILDCOPY_MAX_SIZE fits all of them
+// the wider ones are compiled for their instruction set (target attribute, MSVC doesn't need one) and only ever called once the CPU is known to have it
+#ifdef WFLZ_DISPATCH
+	#include <immintrin.h>
+	#if !defined( _MSC_VER ) || defined( __clang__ )
+		#include <cpuid.h>
+		#define WFLZ_TARGET( isa )   __attribute__(( target( isa ) ))
+		#define WFLZ_FLATTEN         __attribute__(( flatten ))
+	#else
+		#define WFLZ_TARGET( isa )
+		#define WFLZ_FLATTEN
+	#endif
+	#define WFLZ_WILDCOPY_MAX_SIZE   32
+#else
+	#define WFLZ_TARGET( isa )
+	#define WFLZ_FLATTEN
+	#define WFLZ_WILDCOPY_MAX_SIZE   WFLZ_WILDCOPY_SIZE
+#endif
+
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	#define WFLZ_BIG_ENDIAN
+#endif
+
+#ifdef WFLZ_CLOCK
+	#include <chrono>
+#endif
+
+#ifdef WFLZ_THREADS
+	#include <thread>
+	#include <atomic>
+	typedef std::atomic< uint32_t > wfLZ_AtomicCounter;
+	typedef std::atomic< int32_t > wfLZ_AtomicResult;
+#else
+	typedef uint32_t wfLZ_AtomicCounter;
+	typedef int32_t wfLZ_AtomicResult;
+#endif
+
+// furthest back any level can reach
+#define WFLZ_MAX_WINDOW              ( WFLZ_MAX_MATCH_DIST > WFLZ_MAX_MATCH_DIST_FAST ? WFLZ_MAX_MATCH_DIST : WFLZ_MAX_MATCH_DIST_FAST )
+
+// one link per position in the largest match window, so a chain can be followed back as far as a match can reach
+// smaller windows use the next power of 2 above wfLZ_CompressParams::maxDist, see wfLZ_GetWindowSize()
+#define WFLZ_CHAIN_SIZE              ( WFLZ_MAX_WINDOW + 1 )
+
+// worst case number of bytes a single wide literal run + match may write / read, Decompress() only takes the wide path while this much room is left
+#define WFLZ_WILDCOPY_OUT_MARGIN     ( WFLZ_MAX_SEQUENTIAL_LITERALS + WFLZ_MAX_MATCH_LEN + 2*WFLZ_WILDCOPY_MAX_SIZE )
+#define WFLZ_WILDCOPY_IN_MARGIN      ( WFLZ_MAX_SEQUENTIAL_LITERALS + WFLZ_WILDCOPY_MAX_SIZE + WFLZ_BLOCK_SIZE + 1 ) // + 1 for the 5th byte of a far block
+
 // Thanks Daniel A. Newby (Corwinoid) for this bit
 #define WFLZ_LOG2_8BIT( v )  ( 8 - 90/(((v)/4+14)|1) - 2/((v)/2+1) )
 #define WFLZ_LOG2_16BIT( v ) ( 8*((v)>255) + WFLZ_LOG2_8BIT((v) >>8*((v)>255)) ) 
 #define WFLZ_LOG2_32BIT( v ) ( 16*((v)>65535L) + WFLZ_LOG2_16BIT((v)*1L >>16*((v)>65535L)) )
-#define WFLZ_HASH_SHIFT      ( 31 - WFLZ_LOG2_32BIT( WFLZ_DICT_SIZE ) )
 
-#define WFLZ_HASHPTR( x )    (  ( *( (uint32_t*)x ) * 2654435761U )  >>  ( WFLZ_HASH_SHIFT )  )
+// shift = 32 - wfLZ_CompressParams::hashBits
+#define WFLZ_HASHPTR( x, shift ) (  ( *( (uint32_t*)( x ) ) * 2654435761U )  >>  ( shift )  )
 
 typedef struct _wfLZ_Block
 {
-	#ifdef WFLZ_SHORT_WINDOW
-		uint16_t dist:11;  // how far to backtrack to memcpy
-		uint16_t length:5; // how much to memcpy ( +(WFLZ_MIN_MATCH_LEN-1) )
-	#else
-		uint16_t dist;
-		uint8_t length;
-	#endif
+	uint16_t dist;         // how far to backtrack to memcpy
+	uint8_t  length;       // how much to memcpy ( +(WFLZ_MIN_MATCH_LEN-1) )
 	uint8_t  numLiterals;  // how many literals are there until the next wfLZ_Block
 } wfLZ_Block;
 
 typedef struct _wfLZ_Header
 {
-	char     sig[4];         // this can be WFLZ for a single compressed block, or ZLFW for a block-compressed stream
+	char     sig[4];         // this can be WFLZ for a single compressed block, WFL3 for one with short blocks (see wfLZ_ShortBlocks), WFLX for one with far blocks (see wfLZ_FarBlocks), WFLR for a block stored as is (no wfLZ_Blocks at all), WFLS for a stream frame with matches into the frames before it, ZLFW for a block-compressed stream, or ZLF1 / ZLF5 for one with a texture filter (see wfLZ_Filter())
 	uint32_t compressedSize;
 	uint32_t decompressedSize;
 	wfLZ_Block firstBlock;
@@ -97,12 +253,273 @@ typedef struct _wfLZ_ChunkDesc
 
 typedef struct _wfLZ_DictEntry
 {
-	const uint8_t* inPos;
+	uint32_t pos; // base + offset into the input of the most recent position with this hash, see wfLZ_WorkMemBegin()
 } wfLZ_DictEntry;
 
-uint32_t wfLZ_MemCmp( const uint8_t* a, const uint8_t* b, const uint32_t maxLen );
+// the start of every workMem
+typedef struct _wfLZ_WorkMemHeader
+{
+	uint32_t magic;    // WFLZ_WORKMEM_MAGIC once the dictionary has been cleared
+	uint32_t nextBase; // base for the next compression call
+	uint32_t hashBits; // the dictionary size that was cleared
+	uint32_t pad;
+} wfLZ_WorkMemHeader;
+
+#define WFLZ_WORKMEM_MAGIC           0x4d4b5746U // 'FWKM'
+
+// match finding state for a compression call, laid out in workMem by wfLZ_MatchFinderInit()
+typedef struct _wfLZ_MatchFinder
+{
+	wfLZ_DictEntry* dict;        // most recent position for each hash
+	void*           chain;       // Compress(): distance to the previous position with the same hash, one F::ChainLink per position in the window
+	uint32_t*       tree;        // CompressOptimal(): two children per position in the window, in the same place as chain
+	const uint8_t*  start;       // positions are counted from here and matches can't reach before it, earlier than the input when there is history
+	uint32_t        base;        // base + position is what the dictionary holds, see wfLZ_WorkMemBegin()
+	uint32_t        hashShift;
+	uint32_t        windowMask;  // chain / tree entries - 1
+	uint32_t        maxDist;
+	uint32_t        searchDepth;
+	uint32_t        niceLen;     // a match this long is good enough, the search stops there
+#ifdef WFLZ_CLOCK
+	int64_t         deadline;    // steady_clock microseconds the call has to be done by, 0 without a timeLimit, see wfLZ_DeadlineBegin()
+#endif
+#ifdef WFLZ_STATS
+	wfLZ_CompressStats* stats;   // wfLZ_CompressParams::stats, the match finders count their lookups here
+#endif
+} wfLZ_MatchFinder;
+
+// how each wfLZ_CompressParams::level finds matches
+#define WFLZ_STRATEGY_FAST           0 // CompressFast(): one position per hash, takes the first match it finds
+#define WFLZ_STRATEGY_CHAIN          1 // Compress(): follows a chain through every position with the same hash, takes the longest match
+#define WFLZ_STRATEGY_OPTIMAL        2 // CompressOptimal(): binary tree match finder and the cheapest parse
+#define WFLZ_STRATEGY_LAZY           3 // hash chains like Compress(), but looks at the next byte before taking a match
+
+typedef struct _wfLZ_Level
+{
+	uint32_t strategy;
+	uint32_t searchDepth;
+	uint32_t niceLen;
+} wfLZ_Level;
+
+static const wfLZ_Level wfLZ_levels[ WFLZ_LEVEL_MAX + 1 ] =
+{
+	{ WFLZ_STRATEGY_LAZY,    64,                   WFLZ_NICE_MATCH_LEN }, // 0 is WFLZ_LEVEL_DEFAULT
+	{ WFLZ_STRATEGY_FAST,    1,                    WFLZ_MAX_MATCH_LEN  }, // WFLZ_LEVEL_FAST
+	{ WFLZ_STRATEGY_LAZY,    2,                    WFLZ_NICE_MATCH_LEN },
+	{ WFLZ_STRATEGY_LAZY,    4,                    WFLZ_NICE_MATCH_LEN },
+	{ WFLZ_STRATEGY_LAZY,    8,                    WFLZ_NICE_MATCH_LEN },
+	{ WFLZ_STRATEGY_LAZY,    16,                   WFLZ_NICE_MATCH_LEN },
+	{ WFLZ_STRATEGY_LAZY,    64,                   WFLZ_NICE_MATCH_LEN }, // WFLZ_LEVEL_DEFAULT
+	{ WFLZ_STRATEGY_LAZY,    256,                  WFLZ_MAX_MATCH_LEN  },
+	{ WFLZ_STRATEGY_CHAIN,   WFLZ_MAX_CHAIN_DEPTH, WFLZ_MAX_MATCH_LEN  }, // WFLZ_LEVEL_COMPRESS
+	{ WFLZ_STRATEGY_OPTIMAL, WFLZ_MAX_TREE_DEPTH,  WFLZ_MAX_MATCH_LEN  }  // WFLZ_LEVEL_MAX
+};
+
+// compression blocks are written through this: it tracks the current block and the literals that have been added to it
+// the block layout and byte order are the encoder functions' template parameter, see wfLZ_LongBlocks
+typedef struct _wfLZ_Encoder
+{
+	wfLZ_Header header;
+	uint8_t*    block;
+	uint8_t*    dst;
+	uint32_t    numLiterals;
+} wfLZ_Encoder;
+
+// CompressOptimal() cost of reaching a position of the segment
+typedef struct _wfLZ_OptimalNode
+{
+	int32_t  price;      // cheapest way to get here, in bytes relative to the start of the segment
+	int32_t  matchPrice; // cheapest way to get here with a match ending at this position
+	uint32_t litAnchor;  // if price is reached with literals, the position the literal run started from (WFLZ_NO_ANCHOR otherwise)
+	uint32_t matchDist;  // the match giving matchPrice
+	uint16_t matchLen;
+} wfLZ_OptimalNode;
+
+// a position where a literal run can start (right after a match), k = matchPrice - position
+typedef struct _wfLZ_OptimalAnchor
+{
+	uint32_t pos;
+	int32_t  k;
+} wfLZ_OptimalAnchor;
+
+// longest match found at a position, kept for positions the next plan overlaps
+typedef struct _wfLZ_OptimalMatch
+{
+	uint32_t dist;
+	uint16_t len;
+} wfLZ_OptimalMatch;
+
+// all of its state lives in the memory given to wfLZ_StreamCompressorInit(), followed by workMem, the buffer and the frame
+struct _wfLZ_StreamCompressor
+{
+	wfLZ_CompressParams params;      // resolved
+	uint32_t            strategy;
+	wfLZ_MatchFinder    mf;          // start is always buffer, base moves along with the history
+	uint8_t*            buffer;      // historySize bytes of history, then the input collected for the next frame
+	uint32_t            historySize;
+	uint32_t            blockSize;
+	uint32_t            blockFill;
+	uint8_t*            frame;       // a frame that didn't fit in out yet
+	uint32_t            frameSize;
+	uint32_t            frameSent;
+};
+
+// what wfLZ_StreamDecompress() is in the middle of
+#define WFLZ_STREAM_HEADER           0 // collecting a frame header
+#define WFLZ_STREAM_STORED           1 // copying a WFLR frame
+#define WFLZ_STREAM_LITERALS         2
+#define WFLZ_STREAM_BLOCK            3 // collecting a wfLZ_Block
+#define WFLZ_STREAM_MATCH            4
+
+// all of its state lives in the memory given to wfLZ_StreamDecompressorInit(), the output goes around the caller's ring
+struct _wfLZ_StreamDecompressor
+{
+	uint8_t*    ring;
+	uint32_t    ringSize;
+	uint32_t    wide;        // the ring is big enough for DecompressWide() to write past the end of what it copies
+	uint32_t    writePos;
+	uint32_t    readPos;     // oldest byte the caller hasn't consumed
+	uint32_t    unread;
+	uint32_t    history;     // bytes behind writePos that are still in the ring, up to ringSize
+	uint32_t    state;
+	int32_t     error;       // once something went wrong it stays wrong
+	uint32_t    partial;     // bytes of the header / block collected in pending so far
+	uint8_t     pending[ sizeof( wfLZ_Header ) ];
+	wfLZ_Header header;      // of the current frame
+	uint32_t    frameIn;     // bytes used after the header
+	uint32_t    frameOut;
+	uint32_t    count;       // literals / match / stored bytes still to go
+	uint32_t    dist;
+	uint32_t    numLiterals; // literals after the current match
+};
+
+// what the workers of ChunkCompressEx() share, each one takes the next chunk until there are none left
+typedef struct _wfLZ_ChunkJob
+{
+	const uint8_t*     in;
+	uint32_t           inSize;
+	uint32_t           blockSize;
+	uint32_t           numChunks;
+	uint8_t*           slots;           // chunk n is compressed to slots + n*slotSize, then moved into place
+	uint32_t           slotSize;
+	uint32_t*          sizes;           // padded compressed size of each chunk
+	const wfLZ_CompressParams* params;  // ChunkCompressEx()'s, used for every chunk
+	const uint8_t*     workMem;         // worker n uses workMem + n*workMemSize
+	uint32_t           workMemSize;
+	uint32_t           filter;
+	uint8_t*           filterMem;       // with a filter worker n filters each chunk to filterMem + n*blockSize and compresses it from there
+	wfLZ_AtomicCounter nextChunk;
+} wfLZ_ChunkJob;
+
+// same for ChunkDecompressParallel(), every chunk but the last decompresses to chunkSize bytes so chunk n goes to out + n*chunkSize
+typedef struct _wfLZ_ChunkDecompressJob
+{
+	const uint8_t*        in;
+	uint32_t              inSize;          // only checked when safe != 0
+	uint8_t*              out;
+	uint32_t              decompressedSize;
+	const wfLZ_ChunkDesc* chunks;
+	uint32_t              numChunks;
+	uint32_t              chunkSize;
+	uint32_t              safe;
+	uint32_t              swapped;         // written with swapEndian on a machine of the other byte order
+	uint32_t              filter;          // undone on each chunk right after it's decompressed
+	wfLZ_AtomicCounter    nextChunk;
+	wfLZ_AtomicResult     result;          // the first error, workers stop taking chunks once there is one
+} wfLZ_ChunkDecompressJob;
+
+#define WFLZ_NO_ANCHOR               0xffffffffU
+#define WFLZ_ANY_SIZE                0xffffffffU
+#define WFLZ_INFINITE_PRICE          0x3fffffff
+
+static inline uint32_t wfLZ_MemCmp( const uint8_t* a, const uint8_t* b, const uint32_t maxLen );
+static inline uint32_t wfLZ_FirstDiff32( const uint32_t diff );
+static inline uint32_t wfLZ_FirstDiff64( const uint64_t diff );
+static inline uint32_t wfLZ_Ctz32( const uint32_t mask );
 void wfLZ_MemCpy( uint8_t* dst, const uint8_t* src, const uint32_t size );
 void wfLZ_MemSet( uint8_t* dst, const uint8_t value, const uint32_t size );
+static inline uint16_t wfLZ_GetBlockDist( const wfLZ_Block* const block );
+static inline uint32_t wfLZ_Read32( const uint32_t value, const uint32_t swapped );
+static inline uint16_t wfLZ_Load16( const uint8_t* const src );
+static inline void wfLZ_Store16( uint8_t* const dst, const uint16_t value );
+template< uint32_t width > static inline void wfLZ_CopyWide( uint8_t* const dst, const uint8_t* const src );
+template< uint32_t width > static inline void wfLZ_WildCopy( uint8_t* dst, const uint8_t* src, const uint8_t* const dstEnd );
+template< uint32_t width > static inline void wfLZ_WildCopyMatch( uint8_t* dst, const uint32_t dist, const uint32_t len );
+template< uint32_t width > static inline void wfLZ_PatternFill( uint8_t* dst, const uint32_t dist, const uint8_t* const dstEnd );
+template< uint32_t width > static inline void wfLZ_FillWide( uint8_t* dst, const uint8_t* const dstEnd, const uint64_t value );
+static uint32_t wfLZ_ResolveParams( const wfLZ_CompressParams* const params, wfLZ_CompressParams* const resolved, const uint32_t inSize );
+static uint32_t wfLZ_ResolveStreamParams( const wfLZ_CompressParams* const params, wfLZ_CompressParams* const resolved );
+static uint32_t wfLZ_GetWindowSize( const uint32_t maxDist );
+static uint32_t wfLZ_WorkMemBegin( const uint8_t* workMem, const uint32_t inSize, const uint32_t hashBits );
+static void wfLZ_MatchFinderInit( wfLZ_MatchFinder* const mf, const uint8_t* workMem, const uint8_t* const in, const uint32_t inSize, const wfLZ_CompressParams* const params );
+static uint32_t wfLZ_CompressStrategy( const uint32_t strategy, const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf, const wfLZ_CompressParams* const params );
+template< class F > static uint32_t wfLZ_CompressStrategyT( const uint32_t strategy, const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf );
+template< class F > static uint32_t wfLZ_CompressFast_i( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf );
+template< class F > static uint32_t wfLZ_Compress_i( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf );
+template< class F > static uint32_t wfLZ_CompressOptimal_i( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf );
+template< class F > static uint32_t wfLZ_CompressLazy_i( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf );
+template< class F > static uint32_t wfLZ_CompressFastRest( wfLZ_Encoder* const enc, const uint8_t* src, const uint8_t* literals, const uint8_t* const inEnd, uint8_t* const out, wfLZ_MatchFinder* const mf );
+static void wfLZ_DeadlineBegin( wfLZ_MatchFinder* const mf, const uint32_t timeLimit );
+static inline uint32_t wfLZ_OutOfTime( const uint8_t* const src, const uint8_t* const inEnd, const uint8_t** const checkAt, const wfLZ_MatchFinder* const mf );
+template< class F > static inline const uint8_t* wfLZ_ChainInsert( const uint8_t* const pos, wfLZ_MatchFinder* const mf );
+template< class F > static inline const uint8_t* wfLZ_ChainNext( const uint8_t* const pos, const wfLZ_MatchFinder* const mf );
+template< class F > static inline uint32_t wfLZ_ChainFindMatch( const uint8_t* const pos, const uint32_t maxLen, wfLZ_MatchFinder* const mf, uint32_t* const matchDist );
+template< class F > static inline void wfLZ_EncoderInit( wfLZ_Encoder* const enc, uint8_t* const out, const uint32_t inSize );
+template< class F > static inline void wfLZ_EncodeLiterals( wfLZ_Encoder* const enc, const uint8_t* src, const uint32_t count );
+template< class F > static inline void wfLZ_EncodeMatch( wfLZ_Encoder* const enc, const uint32_t dist, const uint32_t len );
+template< class F > static inline uint32_t wfLZ_EncoderFinish( wfLZ_Encoder* const enc, uint8_t* const out );
+static uint32_t wfLZ_CompressStored( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint32_t swapEndian );
+static uint32_t wfLZ_SampleIncompressible( const uint8_t* const in, const uint32_t inSize );
+static inline void wfLZ_CopyStored( uint8_t* dst, const uint8_t* src, const uint32_t size );
+template< class F > static inline uint32_t wfLZ_TreeFindMatch( const uint8_t* const cur, const uint32_t lenLimit, wfLZ_MatchFinder* const mf, uint32_t* const matchDist );
+static uint32_t wfLZ_StreamCompressBlock( wfLZ_StreamCompressor* const stream, uint8_t* const out );
+static void wfLZ_MatchFinderRebase( wfLZ_MatchFinder* const mf, const uint32_t amount, const uint32_t strategy );
+static void wfLZ_MatchFinderInsert( wfLZ_MatchFinder* const mf, const uint8_t* const from, const uint32_t size, const uint32_t strategy );
+#ifdef WFLZ_STATS
+static void wfLZ_AddOutputStats( wfLZ_CompressStats* const stats, const uint8_t* const out, const uint32_t swapEndian );
+template< class F > static void wfLZ_AddOutputStatsT( wfLZ_CompressStats* const stats, const uint8_t* const out );
+static uint32_t wfLZ_Log2( uint32_t value );
+#endif
+static uint32_t wfLZ_ChunkCompressOne( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const wfLZ_CompressParams* const params );
+static void wfLZ_ChunkCompressParams( wfLZ_CompressParams* const params, const uint32_t swapEndian, const uint32_t useFastCompress );
+static void wfLZ_ChunkCompressWorker( void* const jobPtr, const uint32_t workerIdx );
+static uint32_t wfLZ_ResolveNumThreads( const uint32_t numThreads );
+static void wfLZ_RunWorkers( void( *worker )( void* const job, const uint32_t workerIdx ), void* const job, const uint32_t numThreads );
+static int32_t wfLZ_ChunkDecompressBegin( wfLZ_ChunkDecompressJob* const job );
+static int32_t wfLZ_ChunkDecompressRun( wfLZ_ChunkDecompressJob* const job, const uint32_t numThreads );
+static void wfLZ_ChunkDecompressWorker( void* const jobPtr, const uint32_t workerIdx );
+static int32_t wfLZ_ChunkDecompressOne( const wfLZ_ChunkDecompressJob* const job, const uint32_t chunkIdx, uint8_t* const out, const uint32_t outSize );
+static void wfLZ_ChunkDecompressParallel_i( const uint8_t* const in, uint8_t* const out, const uint32_t numThreads, const uint32_t swapped );
+static int32_t wfLZ_ChunkDecompressParallelSafe_i( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint32_t outSize, const uint32_t numThreads, const uint32_t swapped );
+static uint32_t wfLZ_IsChunkTableEnd( const uint32_t numChunks, const uint32_t offset );
+static inline uint32_t wfLZ_IsChunked( const char* const sig );
+static uint32_t wfLZ_FilterBlockSize( const uint32_t filter );
+static void wfLZ_Filter( const uint8_t* const in, const uint32_t size, uint8_t* const out, const uint32_t filter );
+static inline void wfLZ_UnfilterDXT1( uint8_t* const dst, const uint8_t* const planes, const uint32_t numBlocks );
+static inline void wfLZ_UnfilterDXT5( uint8_t* const dst, const uint8_t* const planes, const uint32_t numBlocks );
+static uint32_t wfLZ_ChunkFind( const uint32_t* const index, const uint32_t numChunks, const uint32_t pos );
+template< class E > static uint32_t wfLZ_GetDecompressedSize_i( const uint8_t* const in );
+template< class E > static uint32_t wfLZ_GetCompressedSize_i( const uint8_t* const in );
+template< class E > static void wfLZ_Decompress_i( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out );
+template< class F > static void wfLZ_DecompressT( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out );
+template< class E > static int32_t wfLZ_DecompressSafe_i( const uint8_t* WF_RESTRICT const in, const uint32_t inSize, uint8_t* WF_RESTRICT const out, const uint32_t outSize );
+template< class F > static int32_t wfLZ_DecompressSafeT( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out );
+template< class F > static void wfLZ_DecompressDictT( const uint8_t* const in, uint8_t* const out, const uint8_t* const dict, const uint32_t dictSize );
+static uint32_t wfLZ_InPlaceLead( const uint8_t* const in, const uint32_t inPos, const uint32_t outPos, uint32_t lead );
+template< class F > static uint32_t wfLZ_InPlaceLeadT( const uint8_t* const in, const uint32_t inPos, const uint32_t outPos, uint32_t lead );
+static inline void wfLZ_StreamAdvance( wfLZ_StreamDecompressor* const stream, const uint32_t count );
+static inline int32_t wfLZ_StreamBeginLiterals( wfLZ_StreamDecompressor* const stream, const uint32_t count );
+static inline int32_t wfLZ_StreamEndFrame( wfLZ_StreamDecompressor* const stream );
+typedef int32_t ( *wfLZ_DecompressWideFunc )( const uint8_t** srcPtr, uint8_t** dstPtr, uint8_t* numLiteralsPtr, const uint8_t* const srcEnd, const uint8_t* const out, const uint8_t* const dstEnd, const uint32_t checkDist );
+template< class F > static inline int32_t wfLZ_DecompressWide( const uint8_t** srcPtr, uint8_t** dstPtr, uint8_t* numLiteralsPtr, const uint8_t* const srcEnd, const uint8_t* const out, const uint8_t* const dstEnd, const uint32_t checkDist );
+template< uint32_t width, class F > static inline int32_t wfLZ_DecompressWideT( const uint8_t** srcPtr, uint8_t** dstPtr, uint8_t* numLiteralsPtr, const uint8_t* const srcEnd, const uint8_t* const out, const uint8_t* const dstEnd, const uint32_t checkDist );
+#ifdef WFLZ_DISPATCH
+template< class F > static wfLZ_DecompressWideFunc wfLZ_SelectDecompressWide();
+template< class F > WFLZ_TARGET( "avx2" ) WFLZ_FLATTEN static int32_t wfLZ_DecompressWideAVX2( const uint8_t** srcPtr, uint8_t** dstPtr, uint8_t* numLiteralsPtr, const uint8_t* const srcEnd, const uint8_t* const out, const uint8_t* const dstEnd, const uint32_t checkDist );
+template< class F > WFLZ_TARGET( "sse2" ) WFLZ_FLATTEN static int32_t wfLZ_DecompressWideSSE2( const uint8_t** srcPtr, uint8_t** dstPtr, uint8_t* numLiteralsPtr, const uint8_t* const srcEnd, const uint8_t* const out, const uint8_t* const dstEnd, const uint32_t checkDist );
+static uint32_t wfLZ_DetectCopyWidth();
+static void wfLZ_Cpuid( uint32_t* const regs, const uint32_t leaf );
+#endif
 uint32_t wfLZ_RoundUp( const uint32_t value, const uint32_t base ) { return ( value + ( base - 1 ) ) & ~( base - 1 ); }
 void wfLZ_EndianSwap16( uint16_t* data ) { *data = ( (*data & 0xFF00) >> 8 ) | ( (*data & 0x00FF) << 8 ); }
 void wfLZ_EndianSwap32( uint32_t* data ) { *data = ( (*data & 0xFF000000) >> 24 ) | ( (*data & 0x00FF0000) >> 8 ) | ( (*data & 0x0000FF00) << 8 ) | ( (*data & 0x000000FF) << 24 ); }
@@ -111,28 +528,114 @@ void wfLZ_EndianSwap32( uint32_t* data ) { *data = ( (*data & 0xFF000000) >> 24
 	#define NULL 0
 #endif
 
-//#define WF_LZ_DBG	// writes compression and decompression logs -- if everything is working, these should match!
-
-#ifdef WF_LZ_DBG
-	#include <stdio.h>
-	#define WF_LZ_DBG_COMPRESS_FAST_INIT FILE* dbgFh = fopen( "c:/dev/compress-fast.txt", "wb" );
-	#define WF_LZ_DBG_COMPRESS_INIT      FILE* dbgFh = fopen( "c:/dev/compress.txt", "wb" );
-	#define WF_LZ_DBG_DECOMPRESS_INIT    FILE* dbgFh = fopen( "c:/dev/decompress.txt", "wb" );
-	#define WF_LZ_DBG_PRINT( ... )       fprintf( dbgFh, __VA_ARGS__ ); fflush( dbgFh );
-	#define WF_LZ_DBG_SHUTDOWN           fclose( dbgFh );
-
-	// may as well collect some stats while we're here...
-	uint64_t wfLZ_totalBackTrackDist = 0;
-	uint64_t wfLZ_totalBackTrackLength = 0;
-	uint64_t wfLZ_numBackTracks = 0;
+#ifdef WFLZ_STATS
+	#define WFLZ_STAT_ADD( mf, field, n ) if( ( mf )->stats != NULL ) { ( mf )->stats->field += ( n ); }
 #else
-	#define WF_LZ_DBG_COMPRESS_FAST_INIT
-	#define WF_LZ_DBG_COMPRESS_INIT
-	#define WF_LZ_DBG_DECOMPRESS_INIT
-	#define WF_LZ_DBG_PRINT( ... )
-	#define WF_LZ_DBG_SHUTDOWN
+	#define WFLZ_STAT_ADD( mf, field, n )
 #endif
 
+//! Block Formats
+/*!
+The encoders and decoders are templates on one of these, so each block layout gets its own loops with the block size, match lengths and window
+as constants. WFLZ has wfLZ_Block, WFL3 (WFLZ_BLOCKS_SHORT) packs a block into 3 bytes, WFLX (WFLZ_BLOCKS_FAR) adds a 5th byte to the blocks of far
+matches -- GetBlockSize() is the size of a block that was read, MatchSize() of the one a match will take. E is the byte order of the 16-bit fields and the header,
+wfLZ_NativeEndian or wfLZ_SwappedEndian, for wfLZ_CompressParams::swapEndian and for the ...Swapped decoders that read such data as it is.
+The header has room for a whole wfLZ_Block whatever the layout, a shorter first block leaves the rest of it zeroed.
+*/
+
+struct wfLZ_NativeEndian
+{
+	static inline uint16_t Swap16( const uint16_t value ) { return value; }
+	static inline uint32_t Swap32( const uint32_t value ) { return value; }
+};
+
+struct wfLZ_SwappedEndian
+{
+	static inline uint16_t Swap16( uint16_t value ) { wfLZ_EndianSwap16( &value ); return value; }
+	static inline uint32_t Swap32( uint32_t value ) { wfLZ_EndianSwap32( &value ); return value; }
+};
+
+// wfLZ_Block: 16-bit distance, 8-bit length, numLiterals
+template< class E > struct wfLZ_LongBlocks
+{
+	typedef E        Endian;
+	typedef uint16_t ChainLink;
+	static const char     sig         = 'Z';
+	static const uint32_t blockSize   = WFLZ_BLOCK_SIZE;
+	static const uint32_t minMatchLen = WFLZ_MIN_MATCH_LEN;
+	static const uint32_t maxMatchLen = WFLZ_MAX_MATCH_LEN;
+	static const uint32_t maxDist     = WFLZ_MAX_MATCH_DIST;
+	static inline uint32_t GetBlockSize( const uint8_t* const )         { return blockSize; }
+	static inline uint32_t GetDist( const uint8_t* const block )        { return E::Swap16( wfLZ_Load16( block ) ); }
+	static inline uint32_t GetLength( const uint8_t* const block )      { return block[ 2 ]; }
+	static inline uint32_t GetNumLiterals( const uint8_t* const block ) { return block[ 3 ]; }
+	static inline uint32_t MatchSize( const uint32_t )                  { return blockSize; }
+	static inline void PutMatch( uint8_t* const block, const uint32_t dist, const uint32_t length )
+	{
+		wfLZ_Store16( block, E::Swap16( ( uint16_t )dist ) );
+		block[ 2 ] = ( uint8_t )length;
+	}
+	static inline void PutNumLiterals( uint8_t* const block, const uint32_t numLiterals ) { block[ 3 ] = ( uint8_t )numLiterals; }
+};
+
+// 11-bit distance and 5-bit length in one 16-bit field ( dist | length << 11 ), numLiterals
+template< class E > struct wfLZ_ShortBlocks
+{
+	typedef E        Endian;
+	typedef uint16_t ChainLink;
+	static const char     sig         = '3';
+	static const uint32_t blockSize   = WFLZ_SHORT_BLOCK_SIZE;
+	static const uint32_t minMatchLen = WFLZ_SHORT_MIN_MATCH_LEN;
+	static const uint32_t maxMatchLen = WFLZ_SHORT_MAX_MATCH_LEN;
+	static const uint32_t maxDist     = WFLZ_SHORT_MAX_MATCH_DIST;
+	static inline uint32_t GetBlockSize( const uint8_t* const )         { return blockSize; }
+	static inline uint32_t GetDist( const uint8_t* const block )        { return E::Swap16( wfLZ_Load16( block ) ) & WFLZ_SHORT_MAX_MATCH_DIST; }
+	static inline uint32_t GetLength( const uint8_t* const block )      { return E::Swap16( wfLZ_Load16( block ) ) >> 11; }
+	static inline uint32_t GetNumLiterals( const uint8_t* const block ) { return block[ 2 ]; }
+	static inline uint32_t MatchSize( const uint32_t )                  { return blockSize; }
+	static inline void PutMatch( uint8_t* const block, const uint32_t dist, const uint32_t length )
+	{
+		wfLZ_Store16( block, E::Swap16( ( uint16_t )( dist | length << 11 ) ) );
+	}
+	static inline void PutNumLiterals( uint8_t* const block, const uint32_t numLiterals ) { block[ 2 ] = ( uint8_t )numLiterals; }
+};
+
+// wfLZ_Block with a 15-bit distance, the top bit set means the block has a 5th byte with bits 15 to 22 of the distance
+template< class E > struct wfLZ_FarBlocks
+{
+	typedef E        Endian;
+	typedef uint32_t ChainLink;
+	static const char     sig         = 'X';
+	static const uint32_t blockSize   = WFLZ_BLOCK_SIZE;
+	static const uint32_t minMatchLen = WFLZ_MIN_MATCH_LEN;
+	static const uint32_t maxMatchLen = WFLZ_MAX_MATCH_LEN;
+	static const uint32_t maxDist     = WFLZ_FAR_MAX_MATCH_DIST;
+	static inline uint32_t GetBlockSize( const uint8_t* const block )   { return blockSize + ( E::Swap16( wfLZ_Load16( block ) ) >> 15 ); }
+	static inline uint32_t GetDist( const uint8_t* const block )
+	{
+		const uint32_t dist = E::Swap16( wfLZ_Load16( block ) );
+		return dist <= WFLZ_FAR_NEAR_DIST ? dist : ( dist & WFLZ_FAR_NEAR_DIST ) | ( uint32_t )block[ 4 ] << 15;
+	}
+	static inline uint32_t GetLength( const uint8_t* const block )      { return block[ 2 ]; }
+	static inline uint32_t GetNumLiterals( const uint8_t* const block ) { return block[ 3 ]; }
+	static inline uint32_t MatchSize( const uint32_t dist )             { return blockSize + ( dist > WFLZ_FAR_NEAR_DIST ); }
+	static inline void PutMatch( uint8_t* const block, const uint32_t dist, const uint32_t length )
+	{
+		if( dist > WFLZ_FAR_NEAR_DIST )
+		{
+			wfLZ_Store16( block, E::Swap16( ( uint16_t )( dist | 0x8000U ) ) );
+			block[ 4 ] = ( uint8_t )( dist >> 15 );
+		}
+		else wfLZ_Store16( block, E::Swap16( ( uint16_t )dist ) );
+		block[ 2 ] = ( uint8_t )length;
+	}
+	static inline void PutNumLiterals( uint8_t* const block, const uint32_t numLiterals ) { block[ 3 ] = ( uint8_t )numLiterals; }
+};
+
+typedef wfLZ_LongBlocks< wfLZ_NativeEndian >  wfLZ_NativeLongBlocks;
+typedef wfLZ_ShortBlocks< wfLZ_NativeEndian > wfLZ_NativeShortBlocks;
+typedef wfLZ_FarBlocks< wfLZ_NativeEndian >   wfLZ_NativeFarBlocks;
+
 //! wfLZ_GetMaxCompressedSize()
 
 uint32_t wfLZ_GetMaxCompressedSize( const uint32_t inSize )
@@ -148,596 +651,3422 @@ uint32_t wfLZ_GetMaxCompressedSize( const uint32_t inSize )
 		WFLZ_BLOCK_SIZE;
 }
 
-//! wfLZ_GetWorkMemSize()
+//! wfLZ_WorkMemBegin()
+/*!
+Returns the base for a compression call. Dictionary entries hold base + offset into the input, and every call's base starts a whole window past
+the positions of the previous call, so the previous call's entries are all too far away to match and nothing needs clearing between calls.
+The dictionary is only cleared when workMem is first used, or every few billion input bytes when the 32-bit positions would run out.
+*/
 
-uint32_t wfLZ_GetWorkMemSize()
+static uint32_t wfLZ_WorkMemBegin( const uint8_t* workMem, const uint32_t inSize, const uint32_t hashBits )
 {
-	return WFLZ_DICT_SIZE * sizeof( wfLZ_DictEntry );
+	wfLZ_WorkMemHeader* const header = ( wfLZ_WorkMemHeader* )workMem;
+	uint32_t base;
+	if( header->magic != WFLZ_WORKMEM_MAGIC || header->hashBits != hashBits || ( uint64_t )header->nextBase + inSize + WFLZ_CHAIN_SIZE > 0xffffffffU )
+	{
+		// 0 is then a whole window behind the first base
+		wfLZ_MemSet( ( uint8_t* )( header + 1 ), 0, ( 1U << hashBits ) * sizeof( wfLZ_DictEntry ) );
+		header->magic = WFLZ_WORKMEM_MAGIC;
+		header->hashBits = hashBits;
+		header->nextBase = WFLZ_CHAIN_SIZE;
+	}
+	base = header->nextBase;
+	header->nextBase = base + inSize + WFLZ_CHAIN_SIZE;
+	return base;
 }
 
-//! wfLZ_CompressFast()
+//! wfLZ_ResolveParams()
+/*!
+Fills in the defaults of the level for anything left at 0 and clamps the rest to what the format allows, returns the level's WFLZ_STRATEGY_
+WFLZ_BLOCKS_AUTO goes by inSize, WFLZ_ANY_SIZE when there is no input yet picks the blocks (and window) any input could get
+*/
 
-uint32_t wfLZ_CompressFast( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const uint32_t swapEndian )
+static uint32_t wfLZ_ResolveParams( const wfLZ_CompressParams* const params, wfLZ_CompressParams* const resolved, const uint32_t inSize )
 {
-	wfLZ_Header header;
-	wfLZ_Block* block = &header.firstBlock;
-	uint8_t* dst = out + sizeof( wfLZ_Header );
-	const uint8_t* src = in;
-	uint32_t bytesLeft = inSize;
-	uint32_t numLiterals;
-	wfLZ_DictEntry* dict = ( wfLZ_DictEntry* )workMem;
-
-	#ifdef WFLZ_SHORT_WINDOW
-		if( swapEndian != 0 ) { abort(); } // endian swapping stuffs not set up for bit fields
-	#endif
+	const wfLZ_Level* level;
+	uint32_t maxDist, maxLen, minLen;
+	*resolved = *params;
 
-	WF_LZ_DBG_COMPRESS_FAST_INIT
+	if( resolved->level == 0 ) resolved->level = WFLZ_LEVEL_DEFAULT;
+	if( resolved->level > WFLZ_LEVEL_MAX ) resolved->level = WFLZ_LEVEL_MAX;
+	level = &wfLZ_levels[ resolved->level ];
 
-	WF_LZ_DBG_PRINT( "wfLZ_CompressFast( %u )\n", inSize );
+	if( resolved->blocks == WFLZ_BLOCKS_AUTO ) resolved->blocks = inSize <= WFLZ_SHORT_AUTO_SIZE ? WFLZ_BLOCKS_SHORT : WFLZ_BLOCKS_LONG;
+	if( resolved->blocks != WFLZ_BLOCKS_SHORT && resolved->blocks != WFLZ_BLOCKS_FAR ) resolved->blocks = WFLZ_BLOCKS_LONG;
 
-	// init header
-	header.sig[0] = 'W';
-	header.sig[1] = 'F';
-	header.sig[2] = 'L';
-	header.sig[3] = 'Z';
-	header.compressedSize = WFLZ_MIN_MATCH_LEN;
-	header.decompressedSize = inSize;
+	if( resolved->hashBits == 0 ) resolved->hashBits = resolved->blocks == WFLZ_BLOCKS_FAR && level->strategy != WFLZ_STRATEGY_FAST ? WFLZ_FAR_HASH_BITS : WFLZ_HASH_BITS;
+	if( resolved->hashBits < WFLZ_MIN_HASH_BITS ) resolved->hashBits = WFLZ_MIN_HASH_BITS;
+	if( resolved->hashBits > WFLZ_MAX_HASH_BITS ) resolved->hashBits = WFLZ_MAX_HASH_BITS;
 
-	// init dictionary
-	wfLZ_MemSet( ( uint8_t* )dict, 0, wfLZ_GetWorkMemSize() );
+	if( resolved->searchDepth == 0 ) resolved->searchDepth = level->searchDepth;
 
-	// starting literal characters
+	if( resolved->blocks == WFLZ_BLOCKS_FAR )
 	{
-		const uint8_t* literalsEnd = src + ( WFLZ_MIN_MATCH_LEN > bytesLeft ? bytesLeft : WFLZ_MIN_MATCH_LEN ) ;
-		for(
-			;
-			src != literalsEnd;
-			++src, ++dst, --bytesLeft
-		)
-		{
-			uint32_t hash = WFLZ_HASHPTR( src );
-			if( hash == WFLZ_DICT_SIZE ) --hash;
-			dict[ hash ].inPos = src;
-			*dst = *src;
-			WF_LZ_DBG_PRINT( "  literal [0x%02X] [%c]\n", *src, *src );
-		}
-		numLiterals = src - in;
+		// the far window is opt-in all the way, its default stops well short of the limit to keep workMem down
+		if( resolved->maxDist == 0 ) resolved->maxDist = WFLZ_FAR_MATCH_DIST;
+		if( resolved->maxDist > WFLZ_FAR_MAX_MATCH_DIST ) resolved->maxDist = WFLZ_FAR_MAX_MATCH_DIST;
 	}
-
-	//
+	else
 	{
-		while( bytesLeft )
-		{
-			uint32_t hash = WFLZ_HASHPTR( src );
-			const uint8_t* matchPos;
-			const uint8_t* windowStart = src - WFLZ_MAX_MATCH_DIST_FAST;
-			uint32_t matchLength = 0;
-			const uint32_t maxMatchLen = WFLZ_MAX_MATCH_LEN > bytesLeft ? bytesLeft : WFLZ_MAX_MATCH_LEN ;
-			if( hash == WFLZ_DICT_SIZE ) --hash;
-			matchPos = dict[ hash ].inPos;
-
-			dict[ hash ].inPos = src;
-
-			// a match was found, figure ensure it really is a match (not a hash collision), and determine its length
-			if( matchPos != NULL && matchPos >= windowStart )
-			{
-				matchLength = wfLZ_MemCmp( src, matchPos, maxMatchLen );
-			}
-			if( matchLength >= WFLZ_MIN_MATCH_LEN )
-			{
-				const uint32_t matchDist = src - matchPos;
-
-				block->numLiterals = ( uint8_t )numLiterals;
-				if( swapEndian != 0 ){ wfLZ_EndianSwap16( &block->dist ); }
-				block = ( wfLZ_Block* )dst;
-				bytesLeft -= matchLength;
-				dst += WFLZ_BLOCK_SIZE;
-				src += matchLength;
-				block->dist = ( uint16_t )matchDist;
-				block->length = ( uint8_t )( matchLength - WFLZ_MIN_MATCH_LEN + 1 );
-				numLiterals = 0;
+		maxDist = resolved->blocks == WFLZ_BLOCKS_SHORT ? WFLZ_SHORT_MAX_MATCH_DIST : level->strategy == WFLZ_STRATEGY_FAST ? WFLZ_MAX_MATCH_DIST_FAST : WFLZ_MAX_MATCH_DIST;
+		if( resolved->maxDist == 0 || resolved->maxDist > maxDist ) resolved->maxDist = maxDist;
+	}
 
-				WF_LZ_DBG_PRINT( "  backtrack [%u] len [%u]\n", matchDist, matchLength );
-				#ifdef WF_LZ_DBG
-					wfLZ_totalBackTrackDist += matchDist;
-					wfLZ_totalBackTrackLength += matchLength;
-					++wfLZ_numBackTracks;
-				#endif
+	// short blocks can't hold as long a match, anything shorter than the shortest match that's kept would stop at matches that aren't used
+	maxLen = resolved->blocks == WFLZ_BLOCKS_SHORT ? WFLZ_SHORT_MAX_MATCH_LEN : WFLZ_MAX_MATCH_LEN;
+	minLen = resolved->blocks == WFLZ_BLOCKS_SHORT ? WFLZ_SHORT_MIN_MATCH_LEN + 1 : WFLZ_MIN_MATCH_LEN + 1;
+	if( resolved->niceLen == 0 ) resolved->niceLen = level->niceLen;
+	if( resolved->niceLen > maxLen ) resolved->niceLen = maxLen;
+	if( resolved->niceLen < minLen ) resolved->niceLen = minLen;
 
-				header.compressedSize += WFLZ_BLOCK_SIZE;
-			}
+	return level->strategy;
+}
 
-			// output a literal byte: no entries for this position found, entry is too far away, entry was a hash collision, or the entry did not meet the minimum match length
-			else
-			{
-				// if we've hit the max number of sequential literals, we need to output a compression block header
-				if( numLiterals == WFLZ_MAX_SEQUENTIAL_LITERALS )
-				{
-					block->numLiterals = ( uint8_t )numLiterals;
-					if( swapEndian != 0 ){ wfLZ_EndianSwap16( &block->dist ); }
-					block = ( wfLZ_Block* )dst;
-					dst += WFLZ_BLOCK_SIZE;
-					block->dist = block->length = 0;
-					numLiterals = 0;
-					header.compressedSize += WFLZ_BLOCK_SIZE;
-				}
+//! wfLZ_ResolveStreamParams()
+/*!
+ResolveParams() for a stream compressor. The stream decompressor only reads long blocks: WFLZ_BLOCKS_SHORT still gets its smaller window,
+WFLZ_BLOCKS_FAR gets what WFLZ_BLOCKS_LONG would
+*/
 
-				++numLiterals;
-				--bytesLeft;
-				WF_LZ_DBG_PRINT( "  literal [0x%02X] [%c]\n", *src, *src );
-				*dst++ = *src++;
-				++header.compressedSize;
-			}
-		}
-	}
+static uint32_t wfLZ_ResolveStreamParams( const wfLZ_CompressParams* const params, wfLZ_CompressParams* const resolved )
+{
+	wfLZ_CompressParams longParams = *params;
+	uint32_t strategy;
+	if( longParams.blocks == WFLZ_BLOCKS_FAR ) longParams.blocks = WFLZ_BLOCKS_LONG;
+	strategy = wfLZ_ResolveParams( &longParams, resolved, WFLZ_ANY_SIZE );
+	resolved->blocks = WFLZ_BLOCKS_LONG;
+	return strategy;
+}
 
-	// append the 'end' block
-	{
-		block->numLiterals = ( uint8_t )numLiterals;
-		if( swapEndian != 0 ){ wfLZ_EndianSwap16( &block->dist ); }
-		block = ( wfLZ_Block* )dst;
-		dst += WFLZ_BLOCK_SIZE;
-		block->dist = block->length = block->numLiterals = 0;
-		header.compressedSize += WFLZ_BLOCK_SIZE;
-	}
+//! wfLZ_GetWindowSize()
+/*!
+Number of chain / tree entries for a window, the smallest power of 2 that reaches maxDist back
+*/
 
-	// save the header
-	if( swapEndian != 0 )
-	{
-		wfLZ_EndianSwap32( &header.compressedSize );
-		wfLZ_EndianSwap32( &header.decompressedSize );
-	}
-	*( ( wfLZ_Header* )out ) = header;
+static uint32_t wfLZ_GetWindowSize( const uint32_t maxDist )
+{
+	uint32_t size = 1;
+	while( size <= maxDist ) size <<= 1;
+	return size;
+}
 
-	WF_LZ_DBG_SHUTDOWN
+//! wfLZ_MatchFinderInit()
+/*!
+workMem is laid out as wfLZ_WorkMemHeader, the dictionary, then the chain or tree for the window, see wfLZ_GetWorkMemSizeEx()
+*/
 
-	return dst - out + sizeof( wfLZ_Header );
+static void wfLZ_MatchFinderInit( wfLZ_MatchFinder* const mf, const uint8_t* workMem, const uint8_t* const in, const uint32_t inSize, const wfLZ_CompressParams* const params )
+{
+	mf->dict        = ( wfLZ_DictEntry* )( workMem + sizeof( wfLZ_WorkMemHeader ) );
+	mf->chain       = ( void* )( mf->dict + ( 1U << params->hashBits ) );
+	mf->tree        = ( uint32_t* )( mf->dict + ( 1U << params->hashBits ) );
+	mf->hashShift   = 32 - params->hashBits;
+	mf->windowMask  = wfLZ_GetWindowSize( params->maxDist ) - 1;
+	mf->maxDist     = params->maxDist;
+	mf->searchDepth = params->searchDepth;
+	mf->niceLen     = params->niceLen;
+	mf->start       = in;
+	mf->base        = wfLZ_WorkMemBegin( workMem, inSize, params->hashBits );
+	#ifdef WFLZ_CLOCK
+		mf->deadline = 0;
+	#endif
+	#ifdef WFLZ_STATS
+		mf->stats   = params->stats;
+	#endif
 }
 
-//! wfLZ_Compress()
+//! wfLZ_DeadlineBegin()
+/*!
+Starts the clock on wfLZ_CompressParams::timeLimit milliseconds for one compression call, a stream gets timeLimit for each frame
+*/
 
-uint32_t wfLZ_Compress( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const uint32_t swapEndian )
+static void wfLZ_DeadlineBegin( wfLZ_MatchFinder* const mf, const uint32_t timeLimit )
 {
-	wfLZ_Header header;
-	wfLZ_Block* block = &header.firstBlock;
-	uint8_t* dst = out + sizeof( wfLZ_Header );
-	const uint8_t* src = in;
-	uint32_t bytesLeft = inSize;
-	uint32_t numLiterals = 0;
-	wfLZ_DictEntry* dict = ( wfLZ_DictEntry* )workMem;
-
-	WF_LZ_DBG_COMPRESS_INIT
+	#ifdef WFLZ_CLOCK
+		mf->deadline = 0;
+		if( timeLimit != 0 )
+		{
+			mf->deadline = std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count() + ( int64_t )timeLimit * 1000;
+		}
+	#else
+		( void )mf;
+		( void )timeLimit;
+	#endif
+}
 
-	WF_LZ_DBG_PRINT( "wfLZ_Compress( %u )\n", inSize );
+//! wfLZ_OutOfTime()
+/*!
+Returns 1 once the deadline has passed, the strategies then hand the rest of their input to CompressFastRest()
+Only looks at the clock when src has reached checkAt, and moves checkAt WFLZ_DEADLINE_CHECK bytes along
+*/
 
-	// init header
-	header.sig[0] = 'W';
-	header.sig[1] = 'F';
-	header.sig[2] = 'L';
-	header.sig[3] = 'Z';
-	header.compressedSize = 0;
-	header.decompressedSize = inSize;
+static inline uint32_t wfLZ_OutOfTime( const uint8_t* const src, const uint8_t* const inEnd, const uint8_t** const checkAt, const wfLZ_MatchFinder* const mf )
+{
+	if( src < *checkAt ) return 0;
+	*checkAt = ( uint32_t )( inEnd - src ) > WFLZ_DEADLINE_CHECK ? src + WFLZ_DEADLINE_CHECK : inEnd;
+	#ifdef WFLZ_CLOCK
+		if( mf->deadline != 0 && std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count() >= mf->deadline )
+		{
+			WFLZ_STAT_ADD( mf, fastBytes, ( uint32_t )( inEnd - src ) );
+			return 1;
+		}
+		return 0;
+	#else
+		( void )mf;
+		return 0;
+	#endif
+}
 
-	// init dictionary
-	wfLZ_MemSet( ( uint8_t* )dict, 0, sizeof( wfLZ_DictEntry ) * WFLZ_DICT_SIZE );
+//! wfLZ_CompressStrategy()
+/*!
+Compresses in with the match finder as it was set up, mf->start can be before in so matches reach back into data that was already compressed
+*/
 
-	// the first bytes are always literal
+static uint32_t wfLZ_CompressStrategy( const uint32_t strategy, const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf, const wfLZ_CompressParams* const params )
+{
+	wfLZ_DeadlineBegin( mf, params->timeLimit );
+	if( params->blocks == WFLZ_BLOCKS_FAR )
 	{
-		const uint8_t* literalsEnd;
-		for(
-			literalsEnd = src + ( WFLZ_MIN_MATCH_LEN > bytesLeft ? bytesLeft : WFLZ_MIN_MATCH_LEN ) ;
-			src != literalsEnd ;
-			++dst, ++src, --bytesLeft, ++header.compressedSize, ++numLiterals
-		)
+		if( params->swapEndian != 0 )
 		{
-			uint32_t hash = WFLZ_HASHPTR( src );
-			if( hash == WFLZ_DICT_SIZE ) --hash;
-			dict[ hash ].inPos = src;
-			*dst = *src;
-			WF_LZ_DBG_PRINT( "  literal [0x%02X] [%c]\n", *src, *src );
+			return wfLZ_CompressStrategyT< wfLZ_FarBlocks< wfLZ_SwappedEndian > >( strategy, in, inSize, out, mf );
 		}
+		return wfLZ_CompressStrategyT< wfLZ_NativeFarBlocks >( strategy, in, inSize, out, mf );
 	}
-
-	// iterate through input bytes
-	while( bytesLeft )
+	if( params->blocks == WFLZ_BLOCKS_SHORT )
 	{
-		const uint8_t* windowEnd = src - 1;
-		const uint8_t* window = windowEnd;
-		uint32_t       maxMatchLen;
-		uint32_t       bestMatchDist = 0;
-		uint32_t       bestMatchLen = 0;
-		const uint8_t* windowStart;
-
-		// check hash table for early-fail
-		const uint8_t* hashPos;
-		uint32_t hash = WFLZ_HASHPTR( src );
-		if( hash == WFLZ_DICT_SIZE ) --hash;
-		hashPos = dict[ hash ].inPos;
-		dict[ hash ].inPos = src;
-
-		//
-		if( hashPos != NULL )
+		if( params->swapEndian != 0 )
 		{
-			maxMatchLen = WFLZ_MAX_MATCH_LEN > bytesLeft ? bytesLeft : WFLZ_MAX_MATCH_LEN ;
-			windowStart = src - WFLZ_MAX_MATCH_DIST;
-			if( windowStart > hashPos ) window = hashPos;
-			if( windowStart < in ) windowStart = in;
-
-			// now that we have a search window established for our current position, search it for potential matches
-			for( ; window >= windowStart; --window )
-			{
-				uint32_t matchLen = wfLZ_MemCmp( window, src, maxMatchLen );
-				if( matchLen > bestMatchLen )
-				{
-					bestMatchLen = matchLen;
-					bestMatchDist = src - window;
-					if( matchLen == maxMatchLen )
-					{
-						break;
-					}
-				}
-			}
+			return wfLZ_CompressStrategyT< wfLZ_ShortBlocks< wfLZ_SwappedEndian > >( strategy, in, inSize, out, mf );
 		}
+		return wfLZ_CompressStrategyT< wfLZ_NativeShortBlocks >( strategy, in, inSize, out, mf );
+	}
+	if( params->swapEndian != 0 )
+	{
+		return wfLZ_CompressStrategyT< wfLZ_LongBlocks< wfLZ_SwappedEndian > >( strategy, in, inSize, out, mf );
+	}
+	return wfLZ_CompressStrategyT< wfLZ_NativeLongBlocks >( strategy, in, inSize, out, mf );
+}
 
-		// if a match was found, output the corresponding compression block header
-		if( bestMatchLen > WFLZ_MIN_MATCH_LEN )
-		{
-			block->numLiterals = ( uint8_t )numLiterals;
-			if( swapEndian != 0 ){ wfLZ_EndianSwap16( &block->dist ); }
-			block = ( wfLZ_Block* )dst;
-			bytesLeft -= bestMatchLen;
-			dst += WFLZ_BLOCK_SIZE;
-			src += bestMatchLen;
-			block->dist = ( uint16_t )bestMatchDist;
-			block->length = ( uint8_t )( bestMatchLen - WFLZ_MIN_MATCH_LEN + 1 );
-			numLiterals = 0;
-			WF_LZ_DBG_PRINT( "  backtrack [%u] len [%u]\n", bestMatchDist, bestMatchLen );
-			#ifdef WF_LZ_DBG
-				wfLZ_totalBackTrackDist += bestMatchDist;
-				wfLZ_totalBackTrackLength += bestMatchLen;
-				++wfLZ_numBackTracks;
-			#endif
-			header.compressedSize += WFLZ_BLOCK_SIZE;
-		}
-		// otherwise, output a literal byte
-		else
-		{
-			// if we've hit the max number of sequential literals, we need to output a compression block header
-			if( numLiterals == WFLZ_MAX_SEQUENTIAL_LITERALS )
-			{
-				block->numLiterals = ( uint8_t )numLiterals;
-				if( swapEndian != 0 ){ wfLZ_EndianSwap16( &block->dist ); }
-				block = ( wfLZ_Block* )dst;
-				dst += WFLZ_BLOCK_SIZE;
-				block->dist = block->length = 0;
-				numLiterals = 0;
-				header.compressedSize += WFLZ_BLOCK_SIZE;
-			}
+//! wfLZ_CompressStrategyT()
+/*!
+Every strategy is built for each block format and byte order, wfLZ_CompressStrategy() picks the one params asks for
+*/
 
-			++numLiterals;
-			--bytesLeft;
-			WF_LZ_DBG_PRINT( "  literal [0x%02X] [%c]\n", *src, *src );
-			*dst++ = *src++;
-			++header.compressedSize;
-		}
+template< class F > static uint32_t wfLZ_CompressStrategyT( const uint32_t strategy, const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf )
+{
+	if( strategy == WFLZ_STRATEGY_FAST )
+	{
+		return wfLZ_CompressFast_i< F >( in, inSize, out, mf );
 	}
-
-	// append the 'end' block
+	if( strategy == WFLZ_STRATEGY_CHAIN )
 	{
-		block->numLiterals = ( uint8_t )numLiterals;
-		if( swapEndian != 0 ){ wfLZ_EndianSwap16( &block->dist ); }
-		block = ( wfLZ_Block* )dst;
-		dst += WFLZ_BLOCK_SIZE;
-		block->dist = block->length = block->numLiterals = 0;
-		header.compressedSize += WFLZ_BLOCK_SIZE;
+		return wfLZ_Compress_i< F >( in, inSize, out, mf );
 	}
-
-	// save the header
-	if( swapEndian != 0 )
+	if( strategy == WFLZ_STRATEGY_LAZY )
 	{
-		wfLZ_EndianSwap32( &header.compressedSize );
-		wfLZ_EndianSwap32( &header.decompressedSize );
+		return wfLZ_CompressLazy_i< F >( in, inSize, out, mf );
 	}
-	*( ( wfLZ_Header* )out ) = header;
+	return wfLZ_CompressOptimal_i< F >( in, inSize, out, mf );
+}
 
-	WF_LZ_DBG_SHUTDOWN
+//! wfLZ_CompressParamsInit()
 
-	return dst - out + sizeof( wfLZ_Header );
+void wfLZ_CompressParamsInit( wfLZ_CompressParams* const params, const uint32_t level )
+{
+	wfLZ_MemSet( ( uint8_t* )params, 0, sizeof( wfLZ_CompressParams ) );
+	params->level = level;
 }
 
-//! wfLZ_GetDecompressedSize()
+//! wfLZ_GetWorkMemSizeEx()
 
-uint32_t wfLZ_GetDecompressedSize( const uint8_t* const in )
+uint32_t wfLZ_GetWorkMemSizeEx( const wfLZ_CompressParams* const params )
 {
-	wfLZ_Header* header = ( wfLZ_Header* )in;
-	if(
-		( header->sig[0] == 'W' && header->sig[1] == 'F' && header->sig[2] == 'L' && header->sig[3] == 'Z' )
-		||
-		( header->sig[0] == 'Z' && header->sig[1] == 'L' && header->sig[2] == 'F' && header->sig[3] == 'W' )
-	)
+	wfLZ_CompressParams resolved;
+	const uint32_t strategy = wfLZ_ResolveParams( params, &resolved, WFLZ_ANY_SIZE );
+	const uint32_t windowSize = wfLZ_GetWindowSize( resolved.maxDist );
+	uint32_t size = sizeof( wfLZ_WorkMemHeader ) + ( 1U << resolved.hashBits ) * sizeof( wfLZ_DictEntry );
+	if( strategy == WFLZ_STRATEGY_CHAIN || strategy == WFLZ_STRATEGY_LAZY )
 	{
-		return header->decompressedSize;
+		// one link per position in the window, far ones need all 32 bits
+		size += windowSize * ( resolved.blocks == WFLZ_BLOCKS_FAR ? sizeof( wfLZ_NativeFarBlocks::ChainLink ) : sizeof( wfLZ_NativeLongBlocks::ChainLink ) );
 	}
-	return 0;
+	else if( strategy == WFLZ_STRATEGY_OPTIMAL )
+	{
+		size +=
+			// two children per position in the window
+			windowSize * 2 * sizeof( uint32_t )
+			+
+			// plan for one segment
+			( WFLZ_OPTIMAL_SEGMENT + 1 ) * sizeof( wfLZ_OptimalNode )
+			+
+			( WFLZ_OPTIMAL_SEGMENT + 1 ) * sizeof( wfLZ_OptimalAnchor )
+			+
+			WFLZ_OPTIMAL_SEGMENT * sizeof( wfLZ_OptimalMatch );
+	}
+	return size;
 }
 
-//! wfLZ_GetCompressedSize()
+//! wfLZ_CompressEx()
 
-uint32_t wfLZ_GetCompressedSize( const uint8_t* const in )
+uint32_t wfLZ_CompressEx( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const wfLZ_CompressParams* const params )
 {
-	wfLZ_Header* header = ( wfLZ_Header* )in;
-	if(
-		( header->sig[0] == 'W' && header->sig[1] == 'F' && header->sig[2] == 'L' && header->sig[3] == 'Z' )
-		||
-		( header->sig[0] == 'Z' && header->sig[1] == 'L' && header->sig[2] == 'F' && header->sig[3] == 'W' )
-	)
-	{
-		return header->compressedSize + sizeof( wfLZ_Header );
-	}
-	return 0;
+	wfLZ_CompressParams resolved;
+	const uint32_t strategy = wfLZ_ResolveParams( params, &resolved, inSize );
+	wfLZ_MatchFinder mf;
+	uint32_t compressedSize;
+	#ifdef WFLZ_STATS
+		if( resolved.stats != NULL ) wfLZ_MemSet( ( uint8_t* )resolved.stats, 0, sizeof( wfLZ_CompressStats ) );
+	#endif
+	wfLZ_MatchFinderInit( &mf, workMem, in, inSize, &resolved );
+	compressedSize = wfLZ_CompressStrategy( strategy, in, inSize, out, &mf, &resolved );
+	#ifdef WFLZ_STATS
+		if( resolved.stats != NULL ) wfLZ_AddOutputStats( resolved.stats, out, resolved.swapEndian );
+	#endif
+	return compressedSize;
 }
 
-//! wfLZ_Decompress()
+//! wfLZ_GetWorkMemSize()
 
-void wfLZ_Decompress( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out )
+uint32_t wfLZ_GetWorkMemSize()
 {
-	wfLZ_Header* header = ( wfLZ_Header* )in;
-	uint8_t* dst = out;
-	const uint8_t* src = in + sizeof( wfLZ_Header );
-	uint8_t numLiterals = header->firstBlock.numLiterals;
-	wfLZ_Block* block;
-	uint16_t dist, len;
+	wfLZ_CompressParams params;
+	wfLZ_CompressParamsInit( &params, WFLZ_LEVEL_COMPRESS );
+	return wfLZ_GetWorkMemSizeEx( &params );
+}
 
-	WF_LZ_DBG_DECOMPRESS_INIT
-	WF_LZ_DBG_PRINT( "wfLZ_Decompress()\n" );
+//! wfLZ_CompressFast()
 
-WF_LZ_LITERALS:
-	#if 1
-		WF_LZ_DBG_PRINT( "  literal [0x%02X] [%c]\n", *src, *src );
-		*dst++ = *src++;
-		--numLiterals;
-		if( numLiterals ) goto WF_LZ_LITERALS;
-	#else	// good if lots of uncompressible data, but there usually isn't
-		wfLZ_MemCpy( dst, src, numLiterals );
-		src += numLiterals;
-		dst += numLiterals;
+uint32_t wfLZ_CompressFast( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const uint32_t swapEndian )
+{
+	wfLZ_CompressParams params;
+	wfLZ_CompressParamsInit( &params, WFLZ_LEVEL_FAST );
+	params.swapEndian = swapEndian;
+	// this has always returned sizeof( wfLZ_Header ) more than the compressed size, kept as is for callers that depend on it
+	return wfLZ_CompressEx( in, inSize, out, workMem, &params ) + sizeof( wfLZ_Header );
+}
+
+//! wfLZ_CompressFast_i()
+
+template< class F > static uint32_t wfLZ_CompressFast_i( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf )
+{
+	wfLZ_Encoder enc;
+	const uint8_t* src = in;
+	uint32_t bytesLeft = inSize;
+
+	wfLZ_EncoderInit< F >( &enc, out, inSize );
+
+	// starting literal characters, unless there is history to match against
+	{
+		const uint8_t* const literalsEnd = src + ( in != mf->start ? 0 : F::minMatchLen > bytesLeft ? bytesLeft : F::minMatchLen ) ;
+		for( ; src != literalsEnd; ++src, --bytesLeft )
+		{
+			if( bytesLeft >= sizeof( uint32_t ) )
+			{
+				mf->dict[ WFLZ_HASHPTR( src, mf->hashShift ) ].pos = mf->base + ( uint32_t )( src - mf->start );
+			}
+		}
+	}
+
+	return wfLZ_CompressFastRest< F >( &enc, src, in, in + inSize, out, mf );
+}
+
+//! wfLZ_CompressFastRest()
+/*!
+The main loop of CompressFast(): compresses src up to inEnd with enc, the literals from literals up to src haven't gone out yet, and finishes it.
+The other strategies hand the rest of their input over to this once they run out of time -- every match finder keeps base + position in the
+dictionary, so it carries on with the positions they inserted.
+*/
+
+template< class F > static uint32_t wfLZ_CompressFastRest( wfLZ_Encoder* const enc, const uint8_t* src, const uint8_t* literals, const uint8_t* const inEnd, uint8_t* const out, wfLZ_MatchFinder* const mf )
+{
+	uint32_t bytesLeft = ( uint32_t )( inEnd - src );
+	uint32_t misses = 0;
+
+	{
+		while( bytesLeft )
+		{
+			uint32_t matchDist = 0;
+			uint32_t matchLength = 0;
+			const uint32_t maxMatchLen = F::maxMatchLen > bytesLeft ? bytesLeft : F::maxMatchLen ;
+
+			// nothing to look for when there isn't room for a match
+			if( bytesLeft >= F::minMatchLen )
+			{
+				const uint32_t offset = ( uint32_t )( src - mf->start );
+				wfLZ_DictEntry* const entry = &mf->dict[ WFLZ_HASHPTR( src, mf->hashShift ) ];
+				matchDist = mf->base + offset - entry->pos;
+
+				entry->pos = mf->base + offset;
+				WFLZ_STAT_ADD( mf, hashLookups, 1 );
+
+				// the next 8 bytes repeat the 8 before them: a run of one byte (distance 1) or the same DXT block again (distance 8)
+				// that's the match, whatever the dictionary had, the decompressor fills those with a pattern instead of copying them
+				if( bytesLeft >= 8 && offset >= 8 && mf->maxDist >= 8 && *( const uint64_t* )src == *( const uint64_t* )( src - 8 ) )
+				{
+					matchDist = *( const uint64_t* )src == src[ 0 ] * 0x0101010101010101ULL ? 1 : 8;
+					matchLength = wfLZ_MemCmp( src, src - matchDist, maxMatchLen );
+				}
+
+				// a match was found, figure ensure it really is a match (not a hash collision), and determine its length
+				// after a handover the entry can be this very position (CompressOptimal() searches ahead), matchDist - 1 wraps around for that
+				else if( matchDist - 1 < mf->maxDist && matchDist <= offset )
+				{
+					WFLZ_STAT_ADD( mf, hashHits, 1 );
+					WFLZ_STAT_ADD( mf, candidates, 1 );
+					WFLZ_STAT_ADD( mf, hashCollisions, *( const uint32_t* )src != *( const uint32_t* )( src - matchDist ) );
+					matchLength = wfLZ_MemCmp( src, src - matchDist, maxMatchLen );
+				}
+			}
+			if( matchLength >= F::minMatchLen )
+			{
+				wfLZ_EncodeLiterals< F >( enc, literals, ( uint32_t )( src - literals ) );
+				wfLZ_EncodeMatch< F >( enc, matchDist, matchLength );
+				bytesLeft -= matchLength;
+				src += matchLength;
+				literals = src;
+				misses = 0;
+			}
+
+			// a literal byte: no entries for this position found, entry is too far away, entry was a hash collision, or the entry did not meet the minimum match length
+			// after enough of those in a row, skip the next few bytes without looking for matches in them at all
+			// the literals go out in one go when the next match does
+			else
+			{
+				uint32_t step = 1 + ( misses++ >> WFLZ_SKIP_TRIGGER );
+				if( step > bytesLeft ) step = bytesLeft;
+				src += step;
+				bytesLeft -= step;
+			}
+		}
+	}
+
+	wfLZ_EncodeLiterals< F >( enc, literals, ( uint32_t )( src - literals ) );
+	return wfLZ_EncoderFinish< F >( enc, out );
+}
+
+//! wfLZ_Compress()
+
+uint32_t wfLZ_Compress( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const uint32_t swapEndian )
+{
+	wfLZ_CompressParams params;
+	wfLZ_CompressParamsInit( &params, WFLZ_LEVEL_COMPRESS );
+	params.swapEndian = swapEndian;
+	// same as wfLZ_CompressFast(), one header too many
+	return wfLZ_CompressEx( in, inSize, out, workMem, &params ) + sizeof( wfLZ_Header );
+}
+
+//! wfLZ_Compress_i()
+
+template< class F > static uint32_t wfLZ_Compress_i( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf )
+{
+	wfLZ_Encoder enc;
+	const uint8_t* const inEnd = in + inSize;
+	const uint8_t* src = in;
+	const uint8_t* literals = in;
+	const uint8_t* checkAt = in;
+	uint32_t bytesLeft = inSize;
+
+	wfLZ_EncoderInit< F >( &enc, out, inSize );
+
+	// the first bytes are always literal, unless there is history to match against
+	{
+		const uint8_t* literalsEnd;
+		for(
+			literalsEnd = src + ( in != mf->start ? 0 : F::minMatchLen > bytesLeft ? bytesLeft : F::minMatchLen ) ;
+			src != literalsEnd ;
+			++src, --bytesLeft
+		)
+		{
+			if( bytesLeft >= sizeof( uint32_t ) ) wfLZ_ChainInsert< F >( src, mf );
+		}
+	}
+
+	// iterate through input bytes
+	while( bytesLeft )
+	{
+		uint32_t       bestMatchDist = 0;
+		uint32_t       bestMatchLen = 0;
+
+		if( wfLZ_OutOfTime( src, inEnd, &checkAt, mf ) != 0 ) return wfLZ_CompressFastRest< F >( &enc, src, literals, inEnd, out, mf );
+
+		// a match has to be longer than the shortest one the blocks can hold to be used
+		if( bytesLeft > F::minMatchLen )
+		{
+			bestMatchLen = wfLZ_ChainFindMatch< F >( src, F::maxMatchLen > bytesLeft ? bytesLeft : F::maxMatchLen, mf, &bestMatchDist );
+		}
+
+		// if a match was found, output the literals before it and the corresponding compression block header
+		if( bestMatchLen > F::minMatchLen )
+		{
+			const uint8_t* const matchEnd = src + bestMatchLen;
+			wfLZ_EncodeLiterals< F >( &enc, literals, ( uint32_t )( src - literals ) );
+			wfLZ_EncodeMatch< F >( &enc, bestMatchDist, bestMatchLen );
+			bytesLeft -= bestMatchLen;
+
+			// the positions covered by the match can still be matched against later on, only the end of a long one
+			if( bestMatchLen >= mf->niceLen && bestMatchLen > WFLZ_NICE_MATCH_INSERTS ) src = matchEnd - WFLZ_NICE_MATCH_INSERTS - 1;
+			for( ++src; src != matchEnd; ++src )
+			{
+				if( ( uint32_t )( inEnd - src ) >= sizeof( uint32_t ) ) wfLZ_ChainInsert< F >( src, mf );
+			}
+			literals = src;
+		}
+		// otherwise, it's a literal byte
+		else
+		{
+			++src;
+			--bytesLeft;
+		}
+	}
+
+	wfLZ_EncodeLiterals< F >( &enc, literals, ( uint32_t )( src - literals ) );
+	return wfLZ_EncoderFinish< F >( &enc, out );
+}
+
+//! wfLZ_CompressLazy_i()
+/*!
+The balanced levels: the same hash chains as Compress() searched less deeply, and before a match is taken the next byte is searched too.
+If that finds a longer match the current byte goes out as a literal and the longer match gets the same treatment, so a match never hides
+a longer one that starts a byte later. Like Compress() a match has to be longer than F::minMatchLen, one that short only saves a byte
+and is likely to be in the way of a better one.
+*/
+
+template< class F > static uint32_t wfLZ_CompressLazy_i( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf )
+{
+	wfLZ_Encoder enc;
+	const uint8_t* const inEnd = in + inSize;
+	const uint8_t* src = in;
+	const uint8_t* literals = in;
+	const uint8_t* checkAt = in;
+	uint32_t matchLen = 0;
+	uint32_t matchDist = 0;
+
+	wfLZ_EncoderInit< F >( &enc, out, inSize );
+
+	while( ( uint32_t )( inEnd - src ) > F::minMatchLen )
+	{
+		const uint8_t* insertFrom = src + 1;
+		const uint8_t* insertEnd;
+
+		if( matchLen == 0 )
+		{
+			const uint32_t bytesLeft = ( uint32_t )( inEnd - src );
+			if( wfLZ_OutOfTime( src, inEnd, &checkAt, mf ) != 0 ) return wfLZ_CompressFastRest< F >( &enc, src, literals, inEnd, out, mf );
+			matchLen = wfLZ_ChainFindMatch< F >( src, bytesLeft > F::maxMatchLen ? F::maxMatchLen : bytesLeft, mf, &matchDist );
+			if( matchLen <= F::minMatchLen )
+			{
+				matchLen = 0;
+				++src;
+				continue;
+			}
+		}
+
+		// would starting a byte later be better? not if this one is long enough already
+		if( matchLen < mf->niceLen && ( uint32_t )( inEnd - src ) > F::minMatchLen + 1 )
+		{
+			const uint32_t bytesLeft = ( uint32_t )( inEnd - src ) - 1;
+			uint32_t nextDist = 0;
+			const uint32_t nextLen = wfLZ_ChainFindMatch< F >( src + 1, bytesLeft > F::maxMatchLen ? F::maxMatchLen : bytesLeft, mf, &nextDist );
+			if( nextLen > matchLen )
+			{
+				++src;
+				matchLen = nextLen;
+				matchDist = nextDist;
+				continue;
+			}
+			++insertFrom;
+		}
+
+		wfLZ_EncodeLiterals< F >( &enc, literals, ( uint32_t )( src - literals ) );
+		wfLZ_EncodeMatch< F >( &enc, matchDist, matchLen );
+
+		// the positions covered by the match can still be matched against later on
+		insertEnd = src + matchLen;
+		if( ( uint32_t )( inEnd - insertEnd ) < sizeof( uint32_t ) - 1 ) insertEnd = inEnd - ( sizeof( uint32_t ) - 1 );
+		for( ; insertFrom < insertEnd; ++insertFrom )
+		{
+			wfLZ_ChainInsert< F >( insertFrom, mf );
+		}
+
+		src += matchLen;
+		literals = src;
+		matchLen = 0;
+	}
+
+	wfLZ_EncodeLiterals< F >( &enc, literals, ( uint32_t )( inEnd - literals ) );
+	return wfLZ_EncoderFinish< F >( &enc, out );
+}
+
+//! wfLZ_CompressStored()
+/*!
+Writes in as a WFLR block: the usual header followed by the data as is, returns the size of it
+*/
+
+static uint32_t wfLZ_CompressStored( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint32_t swapEndian )
+{
+	wfLZ_Header* const header = ( wfLZ_Header* )out;
+	header->sig[0] = 'W';
+	header->sig[1] = 'F';
+	header->sig[2] = 'L';
+	header->sig[3] = 'R';
+	header->compressedSize = inSize;
+	header->decompressedSize = inSize;
+	header->firstBlock.dist = header->firstBlock.length = header->firstBlock.numLiterals = 0;
+	if( swapEndian != 0 )
+	{
+		wfLZ_EndianSwap32( &header->compressedSize );
+		wfLZ_EndianSwap32( &header->decompressedSize );
+	}
+	wfLZ_CopyStored( out + sizeof( wfLZ_Header ), in, inSize );
+	return sizeof( wfLZ_Header ) + inSize;
+}
+
+//! wfLZ_SampleIncompressible()
+/*!
+Returns 1 if in is very unlikely to compress, judging by WFLZ_SAMPLE_RUNS runs of bytes spread evenly through it:
+* the bytes have to be about as evenly spread over all 256 values as random data (collision entropy close to 8 bits), and
+* hardly any of the sampled 4 byte sequences may have been seen before in the sample -- data can be made of evenly spread bytes and still
+  repeat itself, runs that land at the same phase of a repeat catch that
+This looks at ~2KB no matter how big the input is, so it errs on the side of compressing: anything it lets through gets compressed and
+is still stored if that didn't make it smaller.
+*/
+
+static uint32_t wfLZ_SampleIncompressible( const uint8_t* const in, const uint32_t inSize )
+{
+	uint32_t counts[ 256 ];
+	uint32_t seen[ 1 << 10 ];
+	const uint32_t numSampled = WFLZ_SAMPLE_RUNS * WFLZ_SAMPLE_RUN_SIZE;
+	uint32_t repeats = 0;
+	uint32_t collisions = 0;
+	uint32_t run, i;
+
+	if( inSize < WFLZ_SAMPLE_RUNS * WFLZ_SAMPLE_RUN_SIZE * 4 ) return 0; // too small for the sample to say much, just compress it
+
+	wfLZ_MemSet( ( uint8_t* )counts, 0, sizeof( counts ) );
+	wfLZ_MemSet( ( uint8_t* )seen, 0, sizeof( seen ) );
+	for( run = 0; run != WFLZ_SAMPLE_RUNS; ++run )
+	{
+		const uint8_t* const sample = in + ( uint32_t )( ( ( uint64_t )( inSize - WFLZ_SAMPLE_RUN_SIZE ) * run ) / ( WFLZ_SAMPLE_RUNS - 1 ) );
+		for( i = 0; i != WFLZ_SAMPLE_RUN_SIZE; ++i )
+		{
+			++counts[ sample[ i ] ];
+		}
+		for( i = 0; i + sizeof( uint32_t ) <= WFLZ_SAMPLE_RUN_SIZE; ++i )
+		{
+			const uint8_t* const pos = sample + i;
+			const uint32_t sequence = *( ( const uint32_t* )pos );
+			const uint32_t hash = WFLZ_HASHPTR( pos, 32 - 10 );
+			if( seen[ hash ] == sequence ) ++repeats;
+			seen[ hash ] = sequence;
+		}
+	}
+
+	// sum of count*(count-1) is how many pairs of sampled bytes are equal, random data has 1/256 of all pairs equal
+	for( i = 0; i != 256; ++i )
+	{
+		if( counts[ i ] > 1 ) collisions += counts[ i ] * ( counts[ i ] - 1 );
+	}
+	return
+		collisions * 256 <= numSampled * ( numSampled - 1 ) * 5 / 4 // within 25% of random
+		&&
+		repeats * 64 < numSampled;
+}
+
+//! wfLZ_GetWorkMemSizeOptimal()
+
+uint32_t wfLZ_GetWorkMemSizeOptimal()
+{
+	wfLZ_CompressParams params;
+	wfLZ_CompressParamsInit( &params, WFLZ_LEVEL_MAX );
+	return wfLZ_GetWorkMemSizeEx( &params );
+}
+
+//! wfLZ_CompressOptimal()
+
+uint32_t wfLZ_CompressOptimal( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const uint32_t swapEndian )
+{
+	wfLZ_CompressParams params;
+	wfLZ_CompressParamsInit( &params, WFLZ_LEVEL_MAX );
+	params.swapEndian = swapEndian;
+	return wfLZ_CompressEx( in, inSize, out, workMem, &params );
+}
+
+//! wfLZ_CompressOptimal_i()
+/*!
+The cost of a parse is exactly its size in the output: each match costs a block (F::MatchSize()), each literal a byte, and a literal run costs
+another block for every WFLZ_MAX_SEQUENTIAL_LITERALS it grows past the first. Every match costs the same, so only the longest match at each
+position matters -- any shorter length can use its distance.
+
+Input is planned a segment at a time by finding the cheapest price for every position. Literal runs make the price of a literal depend on
+where its run started, so literal prices are taken from the anchors (match ends) a run can start at. An anchor further back is only worth
+keeping if it is cheaper by more than the extra blocks its longer run needs. The literal run leading into a segment carries over, so block
+costs stay exact across segments.
+*/
+
+template< class F > static uint32_t wfLZ_CompressOptimal_i( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, wfLZ_MatchFinder* const mf )
+{
+	wfLZ_Encoder enc;
+	wfLZ_OptimalNode* nodes;
+	wfLZ_OptimalAnchor* anchors;
+	wfLZ_OptimalMatch* found;
+	const uint8_t* checkAt = in;
+	uint32_t segStart = 0;
+	uint32_t searched = 0;
+	uint32_t lastMatchEnd = 0;
+
+	wfLZ_EncoderInit< F >( &enc, out, inSize );
+
+	// tree nodes are always written before they are read
+	nodes = ( wfLZ_OptimalNode* )( mf->tree + ( mf->windowMask + 1 ) * 2 );
+	anchors = ( wfLZ_OptimalAnchor* )( nodes + WFLZ_OPTIMAL_SEGMENT + 1 );
+	found = ( wfLZ_OptimalMatch* )( anchors + WFLZ_OPTIMAL_SEGMENT + 1 );
+
+	while( segStart != inSize )
+	{
+		const uint32_t segSize = inSize - segStart > WFLZ_OPTIMAL_SEGMENT ? WFLZ_OPTIMAL_SEGMENT : inSize - segStart;
+		const uint32_t segEnd = segStart + segSize;
+		const uint32_t commitEnd = segEnd == inSize ? segEnd : segEnd - WFLZ_OPTIMAL_LOOKAHEAD;
+		uint32_t numAnchors = 0;
+		uint32_t numPath = 0;
+		uint32_t cursor;
+		uint32_t i;
+
+		// everything before segStart has gone out, literals included, so the rest can go to the fast parser as it is
+		if( wfLZ_OutOfTime( in + segStart, in + inSize, &checkAt, mf ) != 0 ) return wfLZ_CompressFastRest< F >( &enc, in + segStart, in + segStart, in + inSize, out, mf );
+
+		for( i = 0; i <= segSize; ++i )
+		{
+			nodes[ i ].matchPrice = WFLZ_INFINITE_PRICE;
+		}
+
+		// the literal run leading into this segment, or a fresh start right after a match
+		if( lastMatchEnd == segStart )
+		{
+			nodes[ 0 ].matchPrice = 0;
+		}
+		else
+		{
+			const uint32_t run = segStart - lastMatchEnd;
+			anchors[ 0 ].pos = lastMatchEnd;
+			anchors[ 0 ].k = -( int32_t )( run + ( ( run - 1 ) / WFLZ_MAX_SEQUENTIAL_LITERALS ) * F::blockSize ) - ( int32_t )lastMatchEnd;
+			numAnchors = 1;
+		}
+
+		// find the cheapest price for each position
+		for( i = 0; i <= segSize; ++i )
+		{
+			wfLZ_OptimalNode* const node = &nodes[ i ];
+			const uint32_t pos = segStart + i;
+			int32_t litPrice = WFLZ_INFINITE_PRICE;
+			uint32_t litAnchor = WFLZ_NO_ANCHOR;
+			uint32_t a;
+
+			for( a = 0; a != numAnchors; ++a )
+			{
+				const int32_t price = anchors[ a ].k + ( int32_t )pos + ( int32_t )( ( ( pos - anchors[ a ].pos - 1 ) / WFLZ_MAX_SEQUENTIAL_LITERALS ) * F::blockSize );
+				if( price < litPrice )
+				{
+					litPrice = price;
+					litAnchor = anchors[ a ].pos;
+				}
+			}
+
+			if( node->matchPrice <= litPrice )
+			{
+				node->price = node->matchPrice;
+				node->litAnchor = WFLZ_NO_ANCHOR;
+			}
+			else
+			{
+				node->price = litPrice;
+				node->litAnchor = litAnchor;
+			}
+
+			// a match ending here is somewhere a new literal run can start, drop older anchors that can never beat it
+			if( node->matchPrice != WFLZ_INFINITE_PRICE )
+			{
+				const int32_t k = node->matchPrice - ( int32_t )pos;
+				while( numAnchors != 0 && anchors[ numAnchors-1 ].k - k + ( int32_t )( ( ( pos - anchors[ numAnchors-1 ].pos ) / WFLZ_MAX_SEQUENTIAL_LITERALS ) * F::blockSize ) >= 0 )
+				{
+					--numAnchors;
+				}
+				anchors[ numAnchors ].pos = pos;
+				anchors[ numAnchors ].k = k;
+				++numAnchors;
+			}
+
+			// a match starting here costs one block, whatever its length (only its distance can make it bigger)
+			if( i != segSize )
+			{
+				wfLZ_OptimalMatch* const match = &found[ pos & ( WFLZ_OPTIMAL_SEGMENT - 1 ) ];
+				uint32_t matchLen;
+				if( pos == searched )
+				{
+					uint32_t matchDist = 0;
+					match->len = 0;
+					if( inSize - pos >= F::minMatchLen )
+					{
+						match->len = ( uint16_t )wfLZ_TreeFindMatch< F >( in + pos, inSize - pos > F::maxMatchLen ? F::maxMatchLen : inSize - pos, mf, &matchDist );
+					}
+					match->dist = matchDist;
+					++searched;
+				}
+				matchLen = match->len > segSize - i ? segSize - i : match->len;
+				if( matchLen >= F::minMatchLen )
+				{
+					const int32_t price = node->price + ( int32_t )F::MatchSize( match->dist );
+					uint32_t len;
+					for( len = F::minMatchLen; len <= matchLen; ++len )
+					{
+						wfLZ_OptimalNode* const target = &nodes[ i + len ];
+						// on ties the later start wins, so the plan front-loads long matches and the part that gets kept doesn't end on a short one
+						if( price <= target->matchPrice )
+						{
+							target->matchPrice = price;
+							target->matchLen = ( uint16_t )len;
+							target->matchDist = match->dist;
+						}
+					}
+				}
+			}
+		}
+
+		// walk the cheapest path back from the end of the segment, collecting the ends of its matches
+		for( i = segSize; i != 0; /**/ )
+		{
+			if( nodes[ i ].litAnchor != WFLZ_NO_ANCHOR )
+			{
+				if( nodes[ i ].litAnchor <= segStart ) break;
+				i = nodes[ i ].litAnchor - segStart;
+			}
+			anchors[ numPath++ ].pos = i;
+			i -= nodes[ i ].matchLen;
+		}
+
+		// and output it front to back, up to the lookahead -- a match may run past it
+		for( cursor = segStart; numPath != 0; --numPath )
+		{
+			const wfLZ_OptimalNode* const node = &nodes[ anchors[ numPath-1 ].pos ];
+			const uint32_t matchEnd = segStart + anchors[ numPath-1 ].pos;
+			if( matchEnd - node->matchLen >= commitEnd ) break;
+			wfLZ_EncodeLiterals< F >( &enc, in + cursor, matchEnd - node->matchLen - cursor );
+			wfLZ_EncodeMatch< F >( &enc, node->matchDist, node->matchLen );
+			cursor = lastMatchEnd = matchEnd;
+		}
+		if( cursor < commitEnd )
+		{
+			wfLZ_EncodeLiterals< F >( &enc, in + cursor, commitEnd - cursor );
+			cursor = commitEnd;
+		}
+
+		segStart = cursor;
+	}
+
+	return wfLZ_EncoderFinish< F >( &enc, out );
+}
+
+//! wfLZ_GetDecompressedSize()
+
+uint32_t wfLZ_GetDecompressedSize( const uint8_t* const in )
+{
+	return wfLZ_GetDecompressedSize_i< wfLZ_NativeEndian >( in );
+}
+
+//! wfLZ_GetDecompressedSizeSwapped()
+
+uint32_t wfLZ_GetDecompressedSizeSwapped( const uint8_t* const in )
+{
+	return wfLZ_GetDecompressedSize_i< wfLZ_SwappedEndian >( in );
+}
+
+//! wfLZ_GetDecompressedSize_i()
+
+template< class E > static uint32_t wfLZ_GetDecompressedSize_i( const uint8_t* const in )
+{
+	const wfLZ_Header* const header = ( const wfLZ_Header* )in;
+	if(
+		( header->sig[0] == 'W' && header->sig[1] == 'F' && header->sig[2] == 'L' && ( header->sig[3] == 'Z' || header->sig[3] == '3' || header->sig[3] == 'X' || header->sig[3] == 'R' || header->sig[3] == 'S' ) )
+		||
+		wfLZ_IsChunked( header->sig )
+	)
+	{
+		return E::Swap32( header->decompressedSize );
+	}
+	return 0;
+}
+
+//! wfLZ_GetCompressedSize()
+
+uint32_t wfLZ_GetCompressedSize( const uint8_t* const in )
+{
+	return wfLZ_GetCompressedSize_i< wfLZ_NativeEndian >( in );
+}
+
+//! wfLZ_GetCompressedSizeSwapped()
+
+uint32_t wfLZ_GetCompressedSizeSwapped( const uint8_t* const in )
+{
+	return wfLZ_GetCompressedSize_i< wfLZ_SwappedEndian >( in );
+}
+
+//! wfLZ_GetCompressedSize_i()
+
+template< class E > static uint32_t wfLZ_GetCompressedSize_i( const uint8_t* const in )
+{
+	const wfLZ_Header* const header = ( const wfLZ_Header* )in;
+	if(
+		( header->sig[0] == 'W' && header->sig[1] == 'F' && header->sig[2] == 'L' && ( header->sig[3] == 'Z' || header->sig[3] == '3' || header->sig[3] == 'X' || header->sig[3] == 'R' || header->sig[3] == 'S' ) )
+		||
+		wfLZ_IsChunked( header->sig )
+	)
+	{
+		return E::Swap32( header->compressedSize ) + sizeof( wfLZ_Header );
+	}
+	return 0;
+}
+
+//! wfLZ_Decompress()
+
+void wfLZ_Decompress( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out )
+{
+	wfLZ_Decompress_i< wfLZ_NativeEndian >( in, out );
+}
+
+//! wfLZ_DecompressSwapped()
+
+void wfLZ_DecompressSwapped( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out )
+{
+	wfLZ_Decompress_i< wfLZ_SwappedEndian >( in, out );
+}
+
+//! wfLZ_Decompress_i()
+
+template< class E > static void wfLZ_Decompress_i( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out )
+{
+	const wfLZ_Header* const header = ( const wfLZ_Header* )in;
+	if( header->sig[3] == 'R' )
+	{
+		wfLZ_CopyStored( out, in + sizeof( wfLZ_Header ), E::Swap32( header->decompressedSize ) );
+	}
+	else if( header->sig[3] == wfLZ_ShortBlocks< E >::sig )
+	{
+		wfLZ_DecompressT< wfLZ_ShortBlocks< E > >( in, out );
+	}
+	else if( header->sig[3] == wfLZ_FarBlocks< E >::sig )
+	{
+		wfLZ_DecompressT< wfLZ_FarBlocks< E > >( in, out );
+	}
+	else
+	{
+		wfLZ_DecompressT< wfLZ_LongBlocks< E > >( in, out );
+	}
+}
+
+//! wfLZ_DecompressT()
+
+template< class F > static void wfLZ_DecompressT( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out )
+{
+	const wfLZ_Header* const header = ( const wfLZ_Header* )in;
+	uint8_t* dst = out;
+	const uint8_t* src = in + sizeof( wfLZ_Header );
+	uint8_t numLiterals = ( uint8_t )F::GetNumLiterals( ( const uint8_t* )&header->firstBlock );
+	uint32_t dist, len;
+
+	if( wfLZ_DecompressWide< F >( &src, &dst, &numLiterals, src + F::Endian::Swap32( header->compressedSize ), out, out + F::Endian::Swap32( header->decompressedSize ), 0 ) != 0 )
+	{
+		return;
+	}
+
+	// narrow path for the tail of the buffers
+	if( numLiterals == 0 ) goto WF_LZ_BLOCK;
+
+WF_LZ_LITERALS:
+	#if 1
+		*dst++ = *src++;
+		--numLiterals;
+		if( numLiterals ) goto WF_LZ_LITERALS;
+	#else	// good if lots of uncompressible data, but there usually isn't
+		wfLZ_MemCpy( dst, src, numLiterals );
+		src += numLiterals;
+		dst += numLiterals;
+	#endif
+
+WF_LZ_BLOCK:
+	numLiterals = ( uint8_t )F::GetNumLiterals( src );
+	dist = F::GetDist( src );
+	len = F::GetLength( src );
+
+	if( len != 0 )
+	{
+		len += F::minMatchLen - 1;
+		wfLZ_MemCpy( dst, dst - dist, len );
+		dst += len;
+	}
+	src += F::GetBlockSize( src );
+
+	if( numLiterals == 0 )
+	{
+		if( dist == 0 && len == 0 )	// we've reached the end of the input
+		{
+			return;
+		}
+		goto WF_LZ_BLOCK;
+	}
+	else
+	{
+		goto WF_LZ_LITERALS;
+	}
+}
+
+//! wfLZ_DecompressSafe()
+
+int32_t wfLZ_DecompressSafe( const uint8_t* WF_RESTRICT const in, const uint32_t inSize, uint8_t* WF_RESTRICT const out, const uint32_t outSize )
+{
+	return wfLZ_DecompressSafe_i< wfLZ_NativeEndian >( in, inSize, out, outSize );
+}
+
+//! wfLZ_DecompressSafeSwapped()
+
+int32_t wfLZ_DecompressSafeSwapped( const uint8_t* WF_RESTRICT const in, const uint32_t inSize, uint8_t* WF_RESTRICT const out, const uint32_t outSize )
+{
+	return wfLZ_DecompressSafe_i< wfLZ_SwappedEndian >( in, inSize, out, outSize );
+}
+
+//! wfLZ_DecompressSafe_i()
+
+template< class E > static int32_t wfLZ_DecompressSafe_i( const uint8_t* WF_RESTRICT const in, const uint32_t inSize, uint8_t* WF_RESTRICT const out, const uint32_t outSize )
+{
+	const wfLZ_Header* header = ( const wfLZ_Header* )in;
+	uint32_t compressedSize, decompressedSize;
+
+	if( inSize < sizeof( wfLZ_Header ) || !( header->sig[0] == 'W' && header->sig[1] == 'F' && header->sig[2] == 'L' && ( header->sig[3] == 'Z' || header->sig[3] == '3' || header->sig[3] == 'X' || header->sig[3] == 'R' ) ) )
+	{
+		return WFLZ_ERROR_BAD_HEADER;
+	}
+	compressedSize = E::Swap32( header->compressedSize );
+	decompressedSize = E::Swap32( header->decompressedSize );
+	if( compressedSize > inSize - sizeof( wfLZ_Header ) ) return WFLZ_ERROR_INPUT_OVERRUN;
+	if( decompressedSize > outSize ) return WFLZ_ERROR_OUTPUT_OVERRUN;
+	if( header->sig[3] == 'R' )
+	{
+		if( compressedSize != decompressedSize ) return WFLZ_ERROR_CORRUPT;
+		wfLZ_CopyStored( out, in + sizeof( wfLZ_Header ), decompressedSize );
+		return WFLZ_OK;
+	}
+	if( header->sig[3] == wfLZ_ShortBlocks< E >::sig )
+	{
+		return wfLZ_DecompressSafeT< wfLZ_ShortBlocks< E > >( in, out );
+	}
+	if( header->sig[3] == wfLZ_FarBlocks< E >::sig )
+	{
+		return wfLZ_DecompressSafeT< wfLZ_FarBlocks< E > >( in, out );
+	}
+	return wfLZ_DecompressSafeT< wfLZ_LongBlocks< E > >( in, out );
+}
+
+//! wfLZ_DecompressSafeT()
+/*!
+The header has been checked against inSize and outSize
+*/
+
+template< class F > static int32_t wfLZ_DecompressSafeT( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out )
+{
+	const wfLZ_Header* header = ( const wfLZ_Header* )in;
+	const uint8_t* src = in + sizeof( wfLZ_Header );
+	uint8_t* dst = out;
+	const uint8_t* const srcEnd = src + F::Endian::Swap32( header->compressedSize );
+	uint8_t* const dstEnd = out + F::Endian::Swap32( header->decompressedSize );
+	uint8_t numLiterals = ( uint8_t )F::GetNumLiterals( ( const uint8_t* )&header->firstBlock );
+
+	// unchecked while both cursors are far from their ends, it only has to validate match distances
+	int32_t result = wfLZ_DecompressWide< F >( &src, &dst, &numLiterals, srcEnd, out, dstEnd, 1 );
+
+	// checked tail loop
+	while( result == 0 )
+	{
+		uint32_t dist, len;
+
+		if( numLiterals > ( uint32_t )( srcEnd - src ) ) return WFLZ_ERROR_INPUT_OVERRUN;
+		if( numLiterals > ( uint32_t )( dstEnd - dst ) ) return WFLZ_ERROR_OUTPUT_OVERRUN;
+		if( numLiterals != 0 ) wfLZ_MemCpy( dst, src, numLiterals ); // MemCpy always copies at least one round of 8
+		src += numLiterals;
+		dst += numLiterals;
+
+		if( ( uint32_t )( srcEnd - src ) < F::blockSize || ( uint32_t )( srcEnd - src ) < F::GetBlockSize( src ) ) return WFLZ_ERROR_INPUT_OVERRUN;
+		numLiterals = ( uint8_t )F::GetNumLiterals( src );
+		dist = F::GetDist( src );
+		len = F::GetLength( src );
+		src += F::GetBlockSize( src );
+
+		if( len != 0 )
+		{
+			len += F::minMatchLen - 1;
+			if( dist - 1 >= ( uint32_t )( dst - out ) ) return WFLZ_ERROR_CORRUPT;
+			if( len > ( uint32_t )( dstEnd - dst ) ) return WFLZ_ERROR_OUTPUT_OVERRUN;
+			wfLZ_MemCpy( dst, dst - dist, len );
+			dst += len;
+		}
+		else if( numLiterals == 0 && dist == 0 )
+		{
+			result = 1;
+		}
+	}
+
+	if( result < 0 ) return result;
+	return dst == dstEnd ? WFLZ_OK : WFLZ_ERROR_CORRUPT;
+}
+
+//! wfLZ_DecompressDict()
+/*!
+Wide until a match reaches back past out, or the ends of the buffers are close, then one block at a time -- the part of a match before out
+comes from the end of the dictionary, the rest from out
+*/
+
+void wfLZ_DecompressDict( const uint8_t* const in, uint8_t* const out, const uint8_t* const dict, const uint32_t dictSize )
+{
+	const wfLZ_Header* const header = ( const wfLZ_Header* )in;
+	if( header->sig[3] == 'R' )
+	{
+		wfLZ_CopyStored( out, in + sizeof( wfLZ_Header ), header->decompressedSize );
+	}
+	else if( header->sig[3] == wfLZ_NativeShortBlocks::sig )
+	{
+		wfLZ_DecompressDictT< wfLZ_NativeShortBlocks >( in, out, dict, dictSize );
+	}
+	else if( header->sig[3] == wfLZ_NativeFarBlocks::sig )
+	{
+		wfLZ_DecompressDictT< wfLZ_NativeFarBlocks >( in, out, dict, dictSize );
+	}
+	else
+	{
+		wfLZ_DecompressDictT< wfLZ_NativeLongBlocks >( in, out, dict, dictSize );
+	}
+}
+
+//! wfLZ_DecompressDictT()
+
+template< class F > static void wfLZ_DecompressDictT( const uint8_t* const in, uint8_t* const out, const uint8_t* const dict, const uint32_t dictSize )
+{
+	const wfLZ_Header* const header = ( const wfLZ_Header* )in;
+	const uint8_t* src = in + sizeof( wfLZ_Header );
+	const uint8_t* const srcEnd = src + header->compressedSize;
+	const uint8_t* const dictEnd = dict + dictSize;
+	uint8_t* dst = out;
+	uint8_t* const dstEnd = out + header->decompressedSize;
+	uint8_t numLiterals = ( uint8_t )F::GetNumLiterals( ( const uint8_t* )&header->firstBlock );
+
+	for( ;; )
+	{
+		uint32_t dist, len;
+
+		if( wfLZ_DecompressWide< F >( &src, &dst, &numLiterals, srcEnd, out, dstEnd, 1 ) == 1 ) return;
+
+		if( numLiterals != 0 ) wfLZ_MemCpy( dst, src, numLiterals ); // MemCpy always copies at least one round of 8
+		src += numLiterals;
+		dst += numLiterals;
+
+		numLiterals = ( uint8_t )F::GetNumLiterals( src );
+		dist = F::GetDist( src );
+		len = F::GetLength( src );
+		src += F::GetBlockSize( src );
+
+		if( len != 0 )
+		{
+			len += F::minMatchLen - 1;
+			if( dist > ( uint32_t )( dst - out ) )
+			{
+				const uint32_t back = dist - ( uint32_t )( dst - out );
+				const uint32_t count = back < len ? back : len;
+				if( back > dictSize ) return; // a smaller dict than the one it was compressed with
+				wfLZ_MemCpy( dst, dictEnd - back, count );
+				dst += count;
+				len -= count;
+			}
+			if( len != 0 ) wfLZ_MemCpy( dst, dst - dist, len );
+			dst += len;
+		}
+		else if( numLiterals == 0 && dist == 0 ) // we've reached the end of the input
+		{
+			return;
+		}
+	}
+}
+
+//! wfLZ_GetInPlaceMargin()
+/*!
+With the compressed data at the end of the buffer the reads start margin + decompressedSize - compressedSize bytes ahead of the writes. Matches pull
+the writes closer, literals and headers push them further apart. The margin is whatever keeps the writes from ever catching up with the reads.
+*/
+
+uint32_t wfLZ_GetInPlaceMargin( const uint8_t* const in )
+{
+	const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* )in;
+	const uint32_t compressedSize = wfLZ_GetCompressedSize( in );
+	const uint32_t decompressedSize = wfLZ_GetDecompressedSize( in );
+	uint32_t lead = 0;
+
+	if( wfLZ_IsChunked( header->sig ) )
+	{
+		const wfLZ_ChunkDesc* const chunks = ( const wfLZ_ChunkDesc* )( in + sizeof( wfLZ_HeaderChunked ) );
+		uint32_t inPos = header->numChunks != 0 ? chunks[ 0 ].offset : 0;
+		uint32_t outPos = 0;
+		uint32_t chunkIdx;
+		for( chunkIdx = 0; chunkIdx != header->numChunks; ++chunkIdx )
+		{
+			lead = wfLZ_InPlaceLead( in, inPos, outPos, lead );
+			outPos += wfLZ_GetDecompressedSize( in + inPos );
+			inPos += wfLZ_RoundUp( wfLZ_GetCompressedSize( in + inPos ), WFLZ_CHUNK_PAD );
+		}
+	}
+	else
+	{
+		lead = wfLZ_InPlaceLead( in, 0, 0, 0 );
+	}
+
+	return lead + compressedSize > decompressedSize ? lead + compressedSize - decompressedSize : 0;
+}
+
+//! wfLZ_DecompressInPlace()
+
+void wfLZ_DecompressInPlace( const uint8_t* const in, uint8_t* const out )
+{
+	const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* )in;
+	if( wfLZ_IsChunked( header->sig ) )
+	{
+		// the chunk table is overwritten early on, chunks follow one another so each one is found from the last one's header instead
+		const uint32_t numChunks = header->numChunks;
+		const uint32_t filter = wfLZ_GetFilter( in );
+		const uint8_t* chunk = in + ( ( const wfLZ_ChunkDesc* )( in + sizeof( wfLZ_HeaderChunked ) ) )->offset;
+		uint8_t* dst = out;
+		uint32_t chunkIdx;
+		for( chunkIdx = 0; chunkIdx != numChunks; ++chunkIdx )
+		{
+			const uint32_t compressedSize = wfLZ_GetCompressedSize( chunk );
+			const uint32_t decompressedSize = wfLZ_GetDecompressedSize( chunk );
+			wfLZ_Decompress( chunk, dst );
+			wfLZ_Unfilter( dst, decompressedSize, filter );
+			dst += decompressedSize;
+			chunk += wfLZ_RoundUp( compressedSize, WFLZ_CHUNK_PAD );
+		}
+	}
+	else
+	{
+		wfLZ_Decompress( in, out );
+	}
+}
+
+//! wfLZ_InPlaceLead()
+/*!
+Walks the WFLZ / WFL3 / WFLX / WFLR block at in + inPos, decompressing to outPos, and returns the furthest any write gets ahead of the next unread byte
+(or lead if that's further). Writes are counted WFLZ_WILDCOPY_MAX_SIZE past where they end, the wide copies can overshoot that far
+on any CPU, so the margin doesn't depend on which copies the machine doing the decompressing picks.
+*/
+
+static uint32_t wfLZ_InPlaceLead( const uint8_t* const in, const uint32_t inPos, const uint32_t outPos, uint32_t lead )
+{
+	if( in[ inPos + 3 ] == wfLZ_NativeShortBlocks::sig )
+	{
+		return wfLZ_InPlaceLeadT< wfLZ_NativeShortBlocks >( in, inPos, outPos, lead );
+	}
+	if( in[ inPos + 3 ] == wfLZ_NativeFarBlocks::sig )
+	{
+		return wfLZ_InPlaceLeadT< wfLZ_NativeFarBlocks >( in, inPos, outPos, lead );
+	}
+	return wfLZ_InPlaceLeadT< wfLZ_NativeLongBlocks >( in, inPos, outPos, lead );
+}
+
+//! wfLZ_InPlaceLeadT()
+
+template< class F > static uint32_t wfLZ_InPlaceLeadT( const uint8_t* const in, const uint32_t inPos, const uint32_t outPos, uint32_t lead )
+{
+	const wfLZ_Header* const header = ( const wfLZ_Header* )( in + inPos );
+	uint32_t src = inPos + sizeof( wfLZ_Header );
+	uint32_t dst = outPos;
+	uint32_t numLiterals;
+
+	#define WFLZ_IN_PLACE_LEAD() if( dst + WFLZ_WILDCOPY_MAX_SIZE > src && dst + WFLZ_WILDCOPY_MAX_SIZE - src > lead ) lead = dst + WFLZ_WILDCOPY_MAX_SIZE - src;
+
+	if( header->sig[3] == 'R' )
+	{
+		src += header->compressedSize;
+		dst += header->decompressedSize;
+		WFLZ_IN_PLACE_LEAD();
+		return lead;
+	}
+
+	numLiterals = F::GetNumLiterals( ( const uint8_t* )&header->firstBlock );
+	for( ;; )
+	{
+		uint32_t dist, len;
+
+		if( numLiterals != 0 )
+		{
+			src += numLiterals;
+			dst += numLiterals;
+			WFLZ_IN_PLACE_LEAD(); // up to the block after them
+		}
+
+		numLiterals = F::GetNumLiterals( in + src );
+		dist = F::GetDist( in + src );
+		len = F::GetLength( in + src );
+		src += F::GetBlockSize( in + src );
+
+		if( len != 0 )
+		{
+			dst += len + F::minMatchLen - 1;
+			WFLZ_IN_PLACE_LEAD(); // up to the literals after it
+		}
+		else if( numLiterals == 0 && dist == 0 )
+		{
+			break;
+		}
+	}
+
+	#undef WFLZ_IN_PLACE_LEAD
+	return lead;
+}
+
+//! wfLZ_GetHeaderSize()
+
+uint32_t wfLZ_GetHeaderSize( const uint8_t* const in )
+{
+	if( wfLZ_IsChunked( ( const char* )in ) )
+	{
+		const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* )in;
+		return sizeof( wfLZ_HeaderChunked ) + sizeof( wfLZ_ChunkDesc )*header->numChunks;
+	}
+	if( in[0] == 'W' && in[1] == 'F' && in[2] == 'L' && ( in[3] == 'Z' || in[3] == '3' || in[3] == 'X' || in[3] == 'R' || in[3] == 'S' ) )
+	{
+		return sizeof( wfLZ_Header );
+	}
+	return 0;
+}
+
+//! LZC_GetMaxChunkCompressedSize()
+
+uint32_t wfLZ_GetMaxChunkCompressedSize( const uint32_t inSize, const uint32_t blockSize )
+{
+	const uint32_t numChunks = ( (inSize-1) / blockSize ) + 1;
+	return
+		wfLZ_RoundUp( wfLZ_GetMaxCompressedSize( blockSize ), WFLZ_CHUNK_PAD )*numChunks
+		+
+		wfLZ_RoundUp( sizeof( wfLZ_ChunkDesc ) * numChunks, WFLZ_CHUNK_PAD )
+		+
+		sizeof( wfLZ_HeaderChunked )
+	;
+}
+
+//! LZC_ChunkCompress()
+
+uint32_t wfLZ_ChunkCompress( uint8_t* in, const uint32_t inSize, const uint32_t blockSize, uint8_t* out, const uint8_t* workMem, const uint32_t swapEndian, const uint32_t useFastCompress )
+{
+	wfLZ_HeaderChunked* header;
+	wfLZ_ChunkDesc* block;
+	wfLZ_CompressParams params;
+	uint32_t bytesLeft;
+
+	const uint32_t numChunks = ( (inSize-1) / blockSize ) + 1;
+	uint32_t totalCompressedSize = 0;
+
+	header = ( wfLZ_HeaderChunked* )out;
+	block = ( wfLZ_ChunkDesc* )( out+sizeof( wfLZ_HeaderChunked ) );
+	totalCompressedSize += wfLZ_RoundUp( sizeof( wfLZ_HeaderChunked ) + sizeof( wfLZ_ChunkDesc )*numChunks, WFLZ_CHUNK_PAD );
+	wfLZ_MemSet( ( uint8_t* )( block + numChunks ), 0, totalCompressedSize - sizeof( wfLZ_HeaderChunked ) - sizeof( wfLZ_ChunkDesc )*numChunks );
+	out += totalCompressedSize;
+	wfLZ_ChunkCompressParams( &params, swapEndian, useFastCompress );
+
+	for( bytesLeft = inSize; bytesLeft != 0; /**/ )
+	{
+		const uint32_t decompressedSize = bytesLeft >= blockSize ? blockSize : bytesLeft ;
+		const uint32_t compressedSize = wfLZ_ChunkCompressOne( in, decompressedSize, out, workMem, &params );
+		block->offset = totalCompressedSize;
+
+		if( swapEndian != 0 )
+		{
+			wfLZ_EndianSwap32( &block->offset );
+		}
+
+		++block;
+		bytesLeft           -= decompressedSize;
+		in                  += decompressedSize;
+		out                 += compressedSize;
+		totalCompressedSize += compressedSize;
+	}
+
+	header->sig[0]           = 'Z';
+	header->sig[1]           = 'L';
+	header->sig[2]           = 'F';
+	header->sig[3]           = 'W';
+	header->decompressedSize = inSize;
+	header->numChunks        = numChunks;
+	header->compressedSize   = totalCompressedSize - sizeof( wfLZ_HeaderChunked );
+	if( swapEndian != 0 )
+	{
+		wfLZ_EndianSwap32( &header->decompressedSize );
+		wfLZ_EndianSwap32( &header->compressedSize );
+		wfLZ_EndianSwap32( &header->numChunks );
+	}
+
+	return totalCompressedSize;
+}
+
+//! wfLZ_ChunkCompressOne()
+/*!
+Compresses one chunk of ChunkCompress() and zeroes its padding, returns the padded size
+*/
+
+static uint32_t wfLZ_ChunkCompressOne( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const wfLZ_CompressParams* const params )
+{
+	uint32_t compressedSize;
+
+	// chunks that wouldn't get any smaller are stored as they are, then they decompress with a plain copy
+	if( wfLZ_SampleIncompressible( in, inSize ) != 0 )
+	{
+		compressedSize = wfLZ_CompressStored( in, inSize, out, params->swapEndian );
+	}
+	else
+	{
+		compressedSize = wfLZ_CompressEx( in, inSize, out, workMem, params );
+		if( compressedSize >= sizeof( wfLZ_Header ) + inSize )
+		{
+			compressedSize = wfLZ_CompressStored( in, inSize, out, params->swapEndian );
+		}
+	}
+
+	// the same bytes every time, whatever was in out before
+	wfLZ_MemSet( out + compressedSize, 0, wfLZ_RoundUp( compressedSize, WFLZ_CHUNK_PAD ) - compressedSize );
+	return wfLZ_RoundUp( compressedSize, WFLZ_CHUNK_PAD );
+}
+
+//! wfLZ_ChunkCompressParams()
+/*!
+The params ChunkCompress() and ChunkCompressParallel() compress each chunk with
+*/
+
+static void wfLZ_ChunkCompressParams( wfLZ_CompressParams* const params, const uint32_t swapEndian, const uint32_t useFastCompress )
+{
+	wfLZ_CompressParamsInit( params, useFastCompress == 0 ? WFLZ_LEVEL_COMPRESS : WFLZ_LEVEL_FAST );
+	params->swapEndian = swapEndian;
+}
+
+//! wfLZ_GetWorkMemSizeParallel()
+
+uint32_t wfLZ_GetWorkMemSizeParallel( const uint32_t numThreads )
+{
+	return wfLZ_ResolveNumThreads( numThreads ) * wfLZ_RoundUp( wfLZ_GetWorkMemSize(), WFLZ_CHUNK_PAD );
+}
+
+//! wfLZ_GetWorkMemSizeChunkEx()
+
+uint32_t wfLZ_GetWorkMemSizeChunkEx( const wfLZ_CompressParams* const params, const uint32_t blockSize, const uint32_t numThreads )
+{
+	const uint32_t filterSize = wfLZ_FilterBlockSize( params->filter ) != 0 ? wfLZ_RoundUp( blockSize, WFLZ_CHUNK_PAD ) : 0;
+	return wfLZ_ResolveNumThreads( numThreads ) * ( wfLZ_RoundUp( wfLZ_GetWorkMemSizeEx( params ), WFLZ_CHUNK_PAD ) + filterSize );
+}
+
+//! wfLZ_ResolveNumThreads()
+/*!
+0 is one per core
+*/
+
+static uint32_t wfLZ_ResolveNumThreads( const uint32_t numThreads )
+{
+	#ifdef WFLZ_THREADS
+		if( numThreads == 0 )
+		{
+			const uint32_t cores = std::thread::hardware_concurrency();
+			return cores != 0 ? cores : 1;
+		}
+		return numThreads;
+	#else
+		return 1;
+	#endif
+}
+
+//! wfLZ_ChunkCompressParallel()
+
+uint32_t wfLZ_ChunkCompressParallel( const uint8_t* const in, const uint32_t inSize, const uint32_t blockSize, uint8_t* const out, const uint8_t* workMem, const uint32_t numThreads, const uint32_t swapEndian, const uint32_t useFastCompress )
+{
+	wfLZ_CompressParams params;
+	wfLZ_ChunkCompressParams( &params, swapEndian, useFastCompress );
+	return wfLZ_ChunkCompressEx( in, inSize, blockSize, out, workMem, numThreads, &params );
+}
+
+//! wfLZ_ChunkCompressEx()
+/*!
+Every chunk is compressed into a slot big enough for the worst case, laid out in out right after the chunk table -- out already has room for
+that many worst cases. Once they are all done the chunks are moved down into place front to back, each one only ever moves towards the front.
+*/
+
+uint32_t wfLZ_ChunkCompressEx( const uint8_t* const in, const uint32_t inSize, const uint32_t blockSize, uint8_t* const out, const uint8_t* workMem, const uint32_t numThreads, const wfLZ_CompressParams* const params )
+{
+	wfLZ_HeaderChunked* const header = ( wfLZ_HeaderChunked* )out;
+	wfLZ_ChunkDesc* const chunks = ( wfLZ_ChunkDesc* )( out + sizeof( wfLZ_HeaderChunked ) );
+	const uint32_t numChunks = ( (inSize-1) / blockSize ) + 1;
+	const uint32_t tableSize = wfLZ_RoundUp( sizeof( wfLZ_HeaderChunked ) + sizeof( wfLZ_ChunkDesc )*numChunks, WFLZ_CHUNK_PAD );
+	uint32_t threads = wfLZ_ResolveNumThreads( numThreads );
+	uint32_t totalCompressedSize = tableSize;
+	uint32_t chunkIdx;
+	wfLZ_ChunkJob job;
+
+	if( threads > numChunks ) threads = numChunks;
+
+	job.in = in;
+	job.inSize = inSize;
+	job.blockSize = blockSize;
+	job.numChunks = numChunks;
+	job.slots = out + tableSize;
+	job.slotSize = wfLZ_RoundUp( wfLZ_GetMaxCompressedSize( blockSize ), WFLZ_CHUNK_PAD );
+	job.sizes = ( uint32_t* )chunks; // the table isn't needed until the end
+	job.params = params;
+	job.workMem = workMem;
+	job.workMemSize = wfLZ_RoundUp( wfLZ_GetWorkMemSizeEx( params ), WFLZ_CHUNK_PAD );
+	job.filter = wfLZ_FilterBlockSize( params->filter ) != 0 ? params->filter : WFLZ_FILTER_NONE;
+	job.filterMem = ( uint8_t* )workMem + wfLZ_ResolveNumThreads( numThreads )*job.workMemSize;
+	job.nextChunk = 0;
+
+	wfLZ_RunWorkers( wfLZ_ChunkCompressWorker, &job, threads );
+
+	for( chunkIdx = 0; chunkIdx != numChunks; ++chunkIdx )
+	{
+		const uint32_t compressedSize = job.sizes[ chunkIdx ];
+		uint8_t* const slot = job.slots + chunkIdx*job.slotSize;
+		if( slot != out + totalCompressedSize )
+		{
+			wfLZ_MemCpy( out + totalCompressedSize, slot, compressedSize ); // forward, so the overlap is fine
+		}
+		chunks[ chunkIdx ].offset = totalCompressedSize;
+		if( params->swapEndian != 0 )
+		{
+			wfLZ_EndianSwap32( &chunks[ chunkIdx ].offset );
+		}
+		totalCompressedSize += compressedSize;
+	}
+	wfLZ_MemSet( out + sizeof( wfLZ_HeaderChunked ) + sizeof( wfLZ_ChunkDesc )*numChunks, 0, tableSize - sizeof( wfLZ_HeaderChunked ) - sizeof( wfLZ_ChunkDesc )*numChunks );
+
+	header->sig[0]           = 'Z';
+	header->sig[1]           = 'L';
+	header->sig[2]           = 'F';
+	header->sig[3]           = job.filter == WFLZ_FILTER_DXT1 ? '1' : job.filter == WFLZ_FILTER_DXT5 ? '5' : 'W';
+	header->decompressedSize = inSize;
+	header->numChunks        = numChunks;
+	header->compressedSize   = totalCompressedSize - sizeof( wfLZ_HeaderChunked );
+	if( params->swapEndian != 0 )
+	{
+		wfLZ_EndianSwap32( &header->decompressedSize );
+		wfLZ_EndianSwap32( &header->compressedSize );
+		wfLZ_EndianSwap32( &header->numChunks );
+	}
+
+	return totalCompressedSize;
+}
+
+//! wfLZ_ChunkCompressWorker()
+
+static void wfLZ_ChunkCompressWorker( void* const jobPtr, const uint32_t workerIdx )
+{
+	wfLZ_ChunkJob* const job = ( wfLZ_ChunkJob* )jobPtr;
+	const uint8_t* const workMem = job->workMem + workerIdx*job->workMemSize;
+	uint8_t* const filterMem = job->filterMem + workerIdx*wfLZ_RoundUp( job->blockSize, WFLZ_CHUNK_PAD );
+	for( ;; )
+	{
+		const uint32_t chunkIdx = job->nextChunk++;
+		const uint8_t* chunk;
+		uint32_t offset, size;
+		if( chunkIdx >= job->numChunks ) break;
+		offset = chunkIdx*job->blockSize;
+		size = job->inSize - offset >= job->blockSize ? job->blockSize : job->inSize - offset;
+		chunk = job->in + offset;
+		if( job->filter != WFLZ_FILTER_NONE )
+		{
+			wfLZ_Filter( chunk, size, filterMem, job->filter );
+			chunk = filterMem;
+		}
+		job->sizes[ chunkIdx ] = wfLZ_ChunkCompressOne( chunk, size, job->slots + chunkIdx*job->slotSize, workMem, job->params );
+	}
+}
+
+//! wfLZ_RunWorkers()
+/*!
+Runs worker on numThreads threads and waits for all of them, the calling thread is worker 0
+*/
+
+static void wfLZ_RunWorkers( void( *worker )( void* const job, const uint32_t workerIdx ), void* const job, const uint32_t numThreads )
+{
+	#ifdef WFLZ_THREADS
+		std::thread* workers;
+		uint32_t i;
+		if( numThreads <= 1 )
+		{
+			worker( job, 0 );
+			return;
+		}
+		workers = new std::thread[ numThreads - 1 ];
+		for( i = 0; i != numThreads - 1; ++i )
+		{
+			workers[ i ] = std::thread( worker, job, i + 1 );
+		}
+		worker( job, 0 );
+		for( i = 0; i != numThreads - 1; ++i )
+		{
+			workers[ i ].join();
+		}
+		delete[] workers;
+	#else
+		( void )numThreads;
+		worker( job, 0 );
+	#endif
+}
+
+//! wfLZ_ChunkDecompressParallel()
+
+void wfLZ_ChunkDecompressParallel( const uint8_t* const in, uint8_t* const out, const uint32_t numThreads )
+{
+	wfLZ_ChunkDecompressParallel_i( in, out, numThreads, 0 );
+}
+
+//! wfLZ_ChunkDecompressParallelSwapped()
+
+void wfLZ_ChunkDecompressParallelSwapped( const uint8_t* const in, uint8_t* const out, const uint32_t numThreads )
+{
+	wfLZ_ChunkDecompressParallel_i( in, out, numThreads, 1 );
+}
+
+//! wfLZ_ChunkDecompressParallel_i()
+
+static void wfLZ_ChunkDecompressParallel_i( const uint8_t* const in, uint8_t* const out, const uint32_t numThreads, const uint32_t swapped )
+{
+	wfLZ_ChunkDecompressJob job;
+	job.in = in;
+	job.inSize = 0;
+	job.out = out;
+	job.safe = 0;
+	job.swapped = swapped;
+	wfLZ_ChunkDecompressBegin( &job );
+	wfLZ_ChunkDecompressRun( &job, numThreads );
+}
+
+//! wfLZ_ChunkDecompressParallelSafe()
+
+int32_t wfLZ_ChunkDecompressParallelSafe( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint32_t outSize, const uint32_t numThreads )
+{
+	return wfLZ_ChunkDecompressParallelSafe_i( in, inSize, out, outSize, numThreads, 0 );
+}
+
+//! wfLZ_ChunkDecompressParallelSafeSwapped()
+
+int32_t wfLZ_ChunkDecompressParallelSafeSwapped( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint32_t outSize, const uint32_t numThreads )
+{
+	return wfLZ_ChunkDecompressParallelSafe_i( in, inSize, out, outSize, numThreads, 1 );
+}
+
+//! wfLZ_ChunkDecompressParallelSafe_i()
+
+static int32_t wfLZ_ChunkDecompressParallelSafe_i( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint32_t outSize, const uint32_t numThreads, const uint32_t swapped )
+{
+	const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* )in;
+	wfLZ_ChunkDecompressJob job;
+	int32_t result;
+
+	if( inSize < sizeof( wfLZ_HeaderChunked ) || !wfLZ_IsChunked( header->sig ) )
+	{
+		return WFLZ_ERROR_BAD_HEADER;
+	}
+	if( wfLZ_Read32( header->numChunks, swapped ) > ( inSize - sizeof( wfLZ_HeaderChunked ) ) / sizeof( wfLZ_ChunkDesc ) ) return WFLZ_ERROR_INPUT_OVERRUN;
+	if( wfLZ_Read32( header->decompressedSize, swapped ) > outSize ) return WFLZ_ERROR_OUTPUT_OVERRUN;
+
+	job.in = in;
+	job.inSize = inSize;
+	job.out = out;
+	job.safe = 1;
+	job.swapped = swapped;
+	result = wfLZ_ChunkDecompressBegin( &job );
+	if( result != WFLZ_OK ) return result;
+	return wfLZ_ChunkDecompressRun( &job, numThreads );
+}
+
+//! wfLZ_ChunkDecompressBegin()
+/*!
+Reads every chunk's header up front to find where its output goes. wfLZ_ChunkCompress() makes every chunk but the last the same size, and the
+last one no bigger, which puts chunk n at n times the size of the first one. Anything else can't be split up, chunkSize is left 0 and the chunks
+are decompressed one after another.
+*/
+
+static int32_t wfLZ_ChunkDecompressBegin( wfLZ_ChunkDecompressJob* const job )
+{
+	const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* )job->in;
+	uint32_t total = 0;
+	uint32_t chunkIdx;
+
+	job->chunks = ( const wfLZ_ChunkDesc* )( job->in + sizeof( wfLZ_HeaderChunked ) );
+	job->numChunks = wfLZ_Read32( header->numChunks, job->swapped );
+	job->decompressedSize = wfLZ_Read32( header->decompressedSize, job->swapped );
+	job->chunkSize = 0;
+	job->filter = wfLZ_GetFilter( job->in );
+
+	for( chunkIdx = 0; chunkIdx != job->numChunks; ++chunkIdx )
+	{
+		const uint32_t offset = wfLZ_Read32( job->chunks[ chunkIdx ].offset, job->swapped );
+		uint32_t size;
+		if( job->safe != 0 && ( offset > job->inSize || job->inSize - offset < sizeof( wfLZ_Header ) ) ) return WFLZ_ERROR_INPUT_OVERRUN;
+		size = wfLZ_Read32( ( ( const wfLZ_Header* )( job->in + offset ) )->decompressedSize, job->swapped );
+		if( job->safe != 0 && size > job->decompressedSize - total ) return WFLZ_ERROR_CORRUPT;
+		total += size;
+
+		if( chunkIdx == 0 )
+		{
+			job->chunkSize = size;
+		}
+		else if( job->chunkSize != 0 && ( chunkIdx + 1 != job->numChunks ? size != job->chunkSize : size > job->chunkSize ) )
+		{
+			job->chunkSize = 0; // only the last chunk is allowed to be short, never longer
+		}
+	}
+	if( job->safe != 0 && total != job->decompressedSize ) return WFLZ_ERROR_CORRUPT;
+	return WFLZ_OK;
+}
+
+//! wfLZ_ChunkDecompressRun()
+
+static int32_t wfLZ_ChunkDecompressRun( wfLZ_ChunkDecompressJob* const job, const uint32_t numThreads )
+{
+	uint32_t threads = wfLZ_ResolveNumThreads( numThreads );
+
+	job->nextChunk = 0;
+	job->result = WFLZ_OK;
+
+	if( job->chunkSize == 0 )
+	{
+		uint32_t chunkIdx;
+		uint32_t offset = 0;
+		for( chunkIdx = 0; chunkIdx != job->numChunks; ++chunkIdx )
+		{
+			const uint32_t size = wfLZ_Read32( ( ( const wfLZ_Header* )( job->in + wfLZ_Read32( job->chunks[ chunkIdx ].offset, job->swapped ) ) )->decompressedSize, job->swapped );
+			const int32_t result = wfLZ_ChunkDecompressOne( job, chunkIdx, job->out + offset, size );
+			if( result != WFLZ_OK ) return result;
+			offset += size;
+		}
+		return WFLZ_OK;
+	}
+
+	if( threads > job->numChunks ) threads = job->numChunks;
+	wfLZ_RunWorkers( wfLZ_ChunkDecompressWorker, job, threads );
+	return job->result;
+}
+
+//! wfLZ_ChunkDecompressWorker()
+
+static void wfLZ_ChunkDecompressWorker( void* const jobPtr, const uint32_t workerIdx )
+{
+	wfLZ_ChunkDecompressJob* const job = ( wfLZ_ChunkDecompressJob* )jobPtr;
+	( void )workerIdx;
+	while( job->result == WFLZ_OK )
+	{
+		const uint32_t chunkIdx = job->nextChunk++;
+		uint32_t offset, size;
+		int32_t result;
+		if( chunkIdx >= job->numChunks ) break;
+		offset = chunkIdx*job->chunkSize;
+		size = job->decompressedSize - offset >= job->chunkSize ? job->chunkSize : job->decompressedSize - offset;
+		result = wfLZ_ChunkDecompressOne( job, chunkIdx, job->out + offset, size );
+		if( result != WFLZ_OK )
+		{
+			job->result = result;
+		}
+	}
+}
+
+//! wfLZ_ChunkDecompressOne()
+
+static int32_t wfLZ_ChunkDecompressOne( const wfLZ_ChunkDecompressJob* const job, const uint32_t chunkIdx, uint8_t* const out, const uint32_t outSize )
+{
+	const uint32_t offset = wfLZ_Read32( job->chunks[ chunkIdx ].offset, job->swapped );
+	const uint8_t* const chunk = job->in + offset;
+	int32_t result = WFLZ_OK;
+	if( job->swapped != 0 )
+	{
+		if( job->safe != 0 )
+		{
+			result = wfLZ_DecompressSafeSwapped( chunk, job->inSize - offset, out, outSize );
+		}
+		else
+		{
+			wfLZ_DecompressSwapped( chunk, out );
+		}
+	}
+	else if( job->safe != 0 )
+	{
+		result = wfLZ_DecompressSafe( chunk, job->inSize - offset, out, outSize );
+	}
+	else
+	{
+		wfLZ_Decompress( chunk, out );
+	}
+	if( result == WFLZ_OK && job->filter != WFLZ_FILTER_NONE )
+	{
+		wfLZ_Unfilter( out, outSize, job->filter );
+	}
+	return result;
+}
+
+//! wfLZ_GetChunkIndexSize()
+
+uint32_t wfLZ_GetChunkIndexSize( const uint8_t* const in )
+{
+	return ( wfLZ_GetNumChunks( in ) + 1 ) * sizeof( uint32_t );
+}
+
+//! wfLZ_ChunkBuildIndex()
+
+void wfLZ_ChunkBuildIndex( const uint8_t* const in, uint32_t* const index )
+{
+	const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* )in;
+	const wfLZ_ChunkDesc* const chunks = ( const wfLZ_ChunkDesc* )( in + sizeof( wfLZ_HeaderChunked ) );
+	const uint32_t numChunks = header->numChunks;
+	uint32_t offset = 0;
+	uint32_t chunkIdx;
+	for( chunkIdx = 0; chunkIdx != numChunks; ++chunkIdx )
+	{
+		index[ chunkIdx ] = offset;
+		offset += ( ( const wfLZ_Header* )( in + chunks[ chunkIdx ].offset ) )->decompressedSize;
+	}
+	index[ numChunks ] = offset;
+}
+
+//! wfLZ_GetChunkRangeScratchSize()
+
+uint32_t wfLZ_GetChunkRangeScratchSize( const uint8_t* const in )
+{
+	const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* )in;
+	const wfLZ_ChunkDesc* const chunks = ( const wfLZ_ChunkDesc* )( in + sizeof( wfLZ_HeaderChunked ) );
+	uint32_t maxSize = 0;
+	uint32_t chunkIdx;
+	for( chunkIdx = 0; chunkIdx != header->numChunks; ++chunkIdx )
+	{
+		const uint32_t size = ( ( const wfLZ_Header* )( in + chunks[ chunkIdx ].offset ) )->decompressedSize;
+		if( size > maxSize ) maxSize = size;
+	}
+	return maxSize;
+}
+
+//! wfLZ_ChunkDecompressRange()
+/*!
+Chunks entirely inside the range are decompressed straight to where they go in out, the (at most two) chunks it starts or ends partway through
+are decompressed to scratch and only the part in the range is copied.
+*/
+
+uint32_t wfLZ_ChunkDecompressRange( const uint8_t* const in, const uint32_t* const index, const uint32_t start, const uint32_t len, uint8_t* const out, uint8_t* const scratch )
+{
+	const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* )in;
+	const wfLZ_ChunkDesc* const chunks = ( const wfLZ_ChunkDesc* )( in + sizeof( wfLZ_HeaderChunked ) );
+	const uint32_t numChunks = header->numChunks;
+	const uint32_t total = index[ numChunks ];
+	const uint32_t filter = wfLZ_GetFilter( in );
+	uint32_t end;
+	uint32_t chunkIdx;
+
+	if( start >= total || len == 0 ) return 0; // an empty range touches no chunk, scratch may be NULL
+	end = len > total - start ? total : start + len;
+
+	for( chunkIdx = wfLZ_ChunkFind( index, numChunks, start ); chunkIdx != numChunks && index[ chunkIdx ] < end; ++chunkIdx )
+	{
+		const uint8_t* const chunk = in + chunks[ chunkIdx ].offset;
+		const uint32_t chunkStart = index[ chunkIdx ];
+		const uint32_t chunkEnd = index[ chunkIdx + 1 ];
+		if( chunkStart >= start && chunkEnd <= end )
+		{
+			wfLZ_Decompress( chunk, out + ( chunkStart - start ) );
+			wfLZ_Unfilter( out + ( chunkStart - start ), chunkEnd - chunkStart, filter );
+		}
+		else
+		{
+			const uint32_t from = chunkStart > start ? chunkStart : start;
+			const uint32_t to = chunkEnd < end ? chunkEnd : end;
+			wfLZ_Decompress( chunk, scratch );
+			wfLZ_Unfilter( scratch, chunkEnd - chunkStart, filter );
+			if( to != from ) wfLZ_MemCpy( out + ( from - start ), scratch + ( from - chunkStart ), to - from );
+		}
+	}
+
+	return end - start;
+}
+
+//! wfLZ_ChunkFind()
+/*!
+The last chunk starting at or before pos
+*/
+
+static uint32_t wfLZ_ChunkFind( const uint32_t* const index, const uint32_t numChunks, const uint32_t pos )
+{
+	uint32_t lo = 0;
+	uint32_t hi = numChunks;
+	while( hi - lo > 1 )
+	{
+		const uint32_t mid = lo + ( hi - lo ) / 2;
+		if( index[ mid ] <= pos ) lo = mid;
+		else hi = mid;
+	}
+	return lo;
+}
+
+//! wfLZ_GetNumChunks()
+
+uint32_t wfLZ_GetNumChunks( const uint8_t* const in )
+{
+	const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* const )in;
+	if( wfLZ_IsChunked( header->sig ) )
+	{
+		return header->numChunks;
+	}
+	return 0;
+}
+
+//! wfLZ_IsSwapped()
+/*!
+The first chunk always starts right after the chunk table, padded to WFLZ_CHUNK_PAD. A table written in the other byte order only adds up read
+swapped, the odds of it adding up both ways are nil.
+*/
+
+uint32_t wfLZ_IsSwapped( const uint8_t* const in )
+{
+	const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* )in;
+	const wfLZ_ChunkDesc* const chunks = ( const wfLZ_ChunkDesc* )( in + sizeof( wfLZ_HeaderChunked ) );
+	if( wfLZ_IsChunked( header->sig ) )
+	{
+		const uint32_t numChunks = header->numChunks;
+		const uint32_t swappedNumChunks = wfLZ_SwappedEndian::Swap32( numChunks );
+		if( numChunks != 0 && wfLZ_IsChunkTableEnd( numChunks, chunks[ 0 ].offset ) ) return 0;
+		if( swappedNumChunks != 0 && wfLZ_IsChunkTableEnd( swappedNumChunks, wfLZ_SwappedEndian::Swap32( chunks[ 0 ].offset ) ) ) return 1;
+	}
+	return 0;
+}
+
+//! wfLZ_IsChunkTableEnd()
+
+static uint32_t wfLZ_IsChunkTableEnd( const uint32_t numChunks, const uint32_t offset )
+{
+	const uint32_t maxChunks = ( 0xffffffffU - sizeof( wfLZ_HeaderChunked ) - WFLZ_CHUNK_PAD ) / sizeof( wfLZ_ChunkDesc );
+	return numChunks <= maxChunks && offset == wfLZ_RoundUp( sizeof( wfLZ_HeaderChunked ) + sizeof( wfLZ_ChunkDesc )*numChunks, WFLZ_CHUNK_PAD );
+}
+
+//! wfLZ_IsChunked()
+/*! ZLFW, or ZLF1 / ZLF5 with a filter */
+
+static inline uint32_t wfLZ_IsChunked( const char* const sig )
+{
+	return sig[0] == 'Z' && sig[1] == 'L' && sig[2] == 'F' && ( sig[3] == 'W' || sig[3] == '1' || sig[3] == '5' );
+}
+
+//! wfLZ_GetFilter()
+
+uint32_t wfLZ_GetFilter( const uint8_t* const in )
+{
+	const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* )in;
+	if( wfLZ_IsChunked( header->sig ) )
+	{
+		if( header->sig[3] == '1' ) return WFLZ_FILTER_DXT1;
+		if( header->sig[3] == '5' ) return WFLZ_FILTER_DXT5;
+	}
+	return WFLZ_FILTER_NONE;
+}
+
+//! wfLZ_FilterBlockSize()
+/*!
+The size of the texture blocks filter works on, 0 for no filter
+*/
+
+static uint32_t wfLZ_FilterBlockSize( const uint32_t filter )
+{
+	if( filter == WFLZ_FILTER_DXT1 ) return 8;
+	if( filter == WFLZ_FILTER_DXT5 ) return 16;
+	return 0;
+}
+
+//! wfLZ_Filter()
+/*!
+DXT1 blocks are two 565 endpoint colours and 32 bits of 2-bit indices, DXT5 blocks have 8 bytes of alpha (two endpoints, 3-bit indices) in front
+of one of those. Neighbouring blocks often share their endpoints or their indices but not both, so whole blocks rarely match. Every group of
+WFLZ_FILTER_GROUP bytes of blocks is written as the alpha of all of its blocks, then all their endpoints, then all their indices -- alike
+parts end up next to each other and the planes of a chunk's groups still match each other. The bytes after the last whole block are copied as is.
+*/
+
+static void wfLZ_Filter( const uint8_t* const in, const uint32_t size, uint8_t* const out, const uint32_t filter )
+{
+	const uint32_t blockSize = wfLZ_FilterBlockSize( filter );
+	const uint32_t end = size - size % blockSize;
+	uint32_t pos;
+	for( pos = 0; pos != end; /**/ )
+	{
+		const uint32_t groupSize = end - pos < WFLZ_FILTER_GROUP ? end - pos : WFLZ_FILTER_GROUP;
+		const uint32_t numBlocks = groupSize / blockSize;
+		const uint8_t* const src = in + pos;
+		uint8_t* const dst = out + pos;
+		uint32_t i;
+		if( filter == WFLZ_FILTER_DXT5 )
+		{
+			for( i = 0; i != numBlocks; ++i )
+			{
+				*( uint64_t* )( dst + i*8 ) = *( const uint64_t* )( src + i*16 );
+				*( uint32_t* )( dst + numBlocks*8 + i*4 ) = *( const uint32_t* )( src + i*16 + 8 );
+				*( uint32_t* )( dst + numBlocks*12 + i*4 ) = *( const uint32_t* )( src + i*16 + 12 );
+			}
+		}
+		else
+		{
+			for( i = 0; i != numBlocks; ++i )
+			{
+				*( uint32_t* )( dst + i*4 ) = *( const uint32_t* )( src + i*8 );
+				*( uint32_t* )( dst + numBlocks*4 + i*4 ) = *( const uint32_t* )( src + i*8 + 4 );
+			}
+		}
+		pos += groupSize;
+	}
+	if( end != size ) wfLZ_MemCpy( out + end, in + end, size - end );
+}
+
+//! wfLZ_Unfilter()
+/*!
+A group's planes are copied to the stack and its blocks written back over them, on x86 the planes are interleaved 4 blocks at a time with SSE2.
+This runs right after a chunk is decompressed, while all of it is still in cache, at several GB/s it adds little to the decompression time.
+*/
+
+void wfLZ_Unfilter( uint8_t* const data, const uint32_t size, const uint32_t filter )
+{
+	uint64_t planes[ WFLZ_FILTER_GROUP / sizeof( uint64_t ) ];
+	const uint32_t blockSize = wfLZ_FilterBlockSize( filter );
+	uint32_t end, pos;
+	if( blockSize == 0 ) return;
+	end = size - size % blockSize;
+	for( pos = 0; pos != end; /**/ )
+	{
+		const uint32_t groupSize = end - pos < WFLZ_FILTER_GROUP ? end - pos : WFLZ_FILTER_GROUP;
+		wfLZ_CopyStored( ( uint8_t* )planes, data + pos, groupSize );
+		if( filter == WFLZ_FILTER_DXT5 )
+		{
+			wfLZ_UnfilterDXT5( data + pos, ( const uint8_t* )planes, groupSize / 16 );
+		}
+		else
+		{
+			wfLZ_UnfilterDXT1( data + pos, ( const uint8_t* )planes, groupSize / 8 );
+		}
+		pos += groupSize;
+	}
+}
+
+//! wfLZ_UnfilterDXT1()
+
+static inline void wfLZ_UnfilterDXT1( uint8_t* const dst, const uint8_t* const planes, const uint32_t numBlocks )
+{
+	const uint8_t* const colors = planes;
+	const uint8_t* const indices = planes + numBlocks*4;
+	uint32_t i = 0;
+	#if WFLZ_WILDCOPY_SIZE >= 16
+		for( ; i + 4 <= numBlocks; i += 4 )
+		{
+			const __m128i c = _mm_loadu_si128( ( const __m128i* )( colors + i*4 ) );
+			const __m128i x = _mm_loadu_si128( ( const __m128i* )( indices + i*4 ) );
+			_mm_storeu_si128( ( __m128i* )( dst + i*8 ), _mm_unpacklo_epi32( c, x ) );
+			_mm_storeu_si128( ( __m128i* )( dst + i*8 + 16 ), _mm_unpackhi_epi32( c, x ) );
+		}
+	#endif
+	for( ; i != numBlocks; ++i )
+	{
+		*( uint32_t* )( dst + i*8 ) = *( const uint32_t* )( colors + i*4 );
+		*( uint32_t* )( dst + i*8 + 4 ) = *( const uint32_t* )( indices + i*4 );
+	}
+}
+
+//! wfLZ_UnfilterDXT5()
+
+static inline void wfLZ_UnfilterDXT5( uint8_t* const dst, const uint8_t* const planes, const uint32_t numBlocks )
+{
+	const uint8_t* const alpha = planes;
+	const uint8_t* const colors = planes + numBlocks*8;
+	const uint8_t* const indices = planes + numBlocks*12;
+	uint32_t i = 0;
+	#if WFLZ_WILDCOPY_SIZE >= 16
+		for( ; i + 4 <= numBlocks; i += 4 )
+		{
+			const __m128i a01 = _mm_loadu_si128( ( const __m128i* )( alpha + i*8 ) );
+			const __m128i a23 = _mm_loadu_si128( ( const __m128i* )( alpha + i*8 + 16 ) );
+			const __m128i c = _mm_loadu_si128( ( const __m128i* )( colors + i*4 ) );
+			const __m128i x = _mm_loadu_si128( ( const __m128i* )( indices + i*4 ) );
+			const __m128i cx01 = _mm_unpacklo_epi32( c, x );
+			const __m128i cx23 = _mm_unpackhi_epi32( c, x );
+			_mm_storeu_si128( ( __m128i* )( dst + i*16 ), _mm_unpacklo_epi64( a01, cx01 ) );
+			_mm_storeu_si128( ( __m128i* )( dst + i*16 + 16 ), _mm_unpackhi_epi64( a01, cx01 ) );
+			_mm_storeu_si128( ( __m128i* )( dst + i*16 + 32 ), _mm_unpacklo_epi64( a23, cx23 ) );
+			_mm_storeu_si128( ( __m128i* )( dst + i*16 + 48 ), _mm_unpackhi_epi64( a23, cx23 ) );
+		}
+	#endif
+	for( ; i != numBlocks; ++i )
+	{
+		*( uint64_t* )( dst + i*16 ) = *( const uint64_t* )( alpha + i*8 );
+		*( uint32_t* )( dst + i*16 + 8 ) = *( const uint32_t* )( colors + i*4 );
+		*( uint32_t* )( dst + i*16 + 12 ) = *( const uint32_t* )( indices + i*4 );
+	}
+}
+
+//! wfLZ_ChunkDecompressCallback()
+
+void wfLZ_ChunkDecompressCallback( uint8_t* in, void( *chunkCallback )( void* ) )
+{
+	uint32_t chunkIdx;
+	//wfLZ_ChunkDesc* chunk;
+	wfLZ_HeaderChunked* header = ( wfLZ_HeaderChunked* )in;
+	const uint32_t numChunks = header->numChunks;
+	in += sizeof( wfLZ_HeaderChunked );
+
+	//chunk = ( wfLZ_ChunkDesc* )in;
+	in += sizeof( wfLZ_ChunkDesc ) * numChunks;
+
+	for( chunkIdx = 0; chunkIdx != numChunks; ++chunkIdx )
+	{
+		chunkCallback( in );
+		in += wfLZ_RoundUp( wfLZ_GetCompressedSize( in ), WFLZ_CHUNK_PAD );
+	}
+}
+
+//! wfLZ_ChunkDecompressLoop()
+
+uint8_t* wfLZ_ChunkDecompressLoop( uint8_t* in, uint32_t** chunkDesc )
+{
+	wfLZ_HeaderChunked* header = ( wfLZ_HeaderChunked* )in;
+	wfLZ_ChunkDesc* chunks = ( wfLZ_ChunkDesc* )( in + sizeof( wfLZ_HeaderChunked ) );
+	if( *chunkDesc == NULL )
+	{
+		*chunkDesc = ( uint32_t* )chunks;
+	}
+	else
+	{
+		++*chunkDesc;
+		if( *chunkDesc == ( uint32_t* )chunks + header->numChunks ) { return NULL; }
+	}
+	return in + **chunkDesc;
+}
+
+//! wfLZ_GetStreamCompressorSize()
+
+uint32_t wfLZ_GetStreamCompressorSize( const wfLZ_CompressParams* const params, const uint32_t blockSize )
+{
+	wfLZ_CompressParams resolved;
+	const uint32_t frameSize = blockSize == 0 ? WFLZ_STREAM_BLOCK_SIZE : blockSize;
+	wfLZ_ResolveStreamParams( params, &resolved );
+	return
+		wfLZ_RoundUp( sizeof( wfLZ_StreamCompressor ), WFLZ_CHUNK_PAD )
+		+
+		wfLZ_RoundUp( wfLZ_GetWorkMemSizeEx( &resolved ), WFLZ_CHUNK_PAD )
+		+
+		// history and the next frame's input
+		wfLZ_RoundUp( resolved.maxDist + frameSize, WFLZ_CHUNK_PAD )
+		+
+		wfLZ_GetMaxCompressedSize( frameSize );
+}
+
+//! wfLZ_StreamCompressorInit()
+
+wfLZ_StreamCompressor* wfLZ_StreamCompressorInit( uint8_t* const mem, const wfLZ_CompressParams* const params, const uint32_t blockSize )
+{
+	wfLZ_StreamCompressor* const stream = ( wfLZ_StreamCompressor* )mem;
+	uint8_t* workMem;
+	stream->strategy = wfLZ_ResolveStreamParams( params, &stream->params );
+	stream->blockSize = blockSize == 0 ? WFLZ_STREAM_BLOCK_SIZE : blockSize;
+	workMem = mem + wfLZ_RoundUp( sizeof( wfLZ_StreamCompressor ), WFLZ_CHUNK_PAD );
+	stream->buffer = workMem + wfLZ_RoundUp( wfLZ_GetWorkMemSizeEx( &stream->params ), WFLZ_CHUNK_PAD );
+	stream->frame = stream->buffer + wfLZ_RoundUp( stream->params.maxDist + stream->blockSize, WFLZ_CHUNK_PAD );
+	stream->historySize = 0;
+	stream->blockFill = 0;
+	stream->frameSize = 0;
+	stream->frameSent = 0;
+
+	// mem is probably fresh, make sure the dictionary gets cleared
+	( ( wfLZ_WorkMemHeader* )workMem )->magic = 0;
+	wfLZ_MatchFinderInit( &stream->mf, workMem, stream->buffer, 0, &stream->params );
+	#ifdef WFLZ_STATS
+		if( stream->params.stats != NULL ) wfLZ_MemSet( ( uint8_t* )stream->params.stats, 0, sizeof( wfLZ_CompressStats ) );
+	#endif
+	return stream;
+}
+
+//! wfLZ_StreamCompress()
+
+uint32_t wfLZ_StreamCompress( wfLZ_StreamCompressor* const stream, const uint8_t* const in, const uint32_t inSize, uint32_t* const inUsed, uint8_t* const out, const uint32_t outSize, const uint32_t flush )
+{
+	const uint32_t maxFrameSize = wfLZ_GetMaxCompressedSize( stream->blockSize );
+	uint32_t used = 0;
+	uint32_t written = 0;
+
+	for( ;; )
+	{
+		// the rest of a frame that didn't fit last time goes first
+		if( stream->frameSent != stream->frameSize )
+		{
+			uint32_t count = stream->frameSize - stream->frameSent;
+			if( count > outSize - written ) count = outSize - written;
+			if( count != 0 ) wfLZ_MemCpy( out + written, stream->frame + stream->frameSent, count );
+			stream->frameSent += count;
+			written += count;
+			if( stream->frameSent != stream->frameSize ) break; // out is full
+		}
+
+		if( used != inSize && stream->blockFill != stream->blockSize )
+		{
+			uint32_t count = stream->blockSize - stream->blockFill;
+			if( count > inSize - used ) count = inSize - used;
+			wfLZ_MemCpy( stream->buffer + stream->historySize + stream->blockFill, in + used, count );
+			stream->blockFill += count;
+			used += count;
+		}
+		else if( stream->blockFill == stream->blockSize || ( flush != 0 && stream->blockFill != 0 ) )
+		{
+			// straight into out when the worst case fits, otherwise through the frame buffer
+			if( outSize - written >= maxFrameSize )
+			{
+				written += wfLZ_StreamCompressBlock( stream, out + written );
+			}
+			else
+			{
+				stream->frameSize = wfLZ_StreamCompressBlock( stream, stream->frame );
+				stream->frameSent = 0;
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	*inUsed = used;
+	return written;
+}
+
+//! wfLZ_StreamCompressBlock()
+/*!
+Compresses the input collected after the history into a frame at out and returns its size, then keeps the last maxDist bytes as the history
+for the next one. The history only ever moves, the match finder follows it by moving base the same amount, so nothing needs re-inserting.
+*/
+
+static uint32_t wfLZ_StreamCompressBlock( wfLZ_StreamCompressor* const stream, uint8_t* const out )
+{
+	const uint8_t* const block = stream->buffer + stream->historySize;
+	const uint32_t total = stream->historySize + stream->blockFill;
+	const uint32_t keep = total > stream->params.maxDist ? stream->params.maxDist : total;
+	uint32_t compressedSize;
+
+	if( wfLZ_SampleIncompressible( block, stream->blockFill ) != 0 )
+	{
+		compressedSize = wfLZ_CompressStored( block, stream->blockFill, out, stream->params.swapEndian );
+	}
+	else
+	{
+		compressedSize = wfLZ_CompressStrategy( stream->strategy, block, stream->blockFill, out, &stream->mf, &stream->params );
+		if( compressedSize >= sizeof( wfLZ_Header ) + stream->blockFill )
+		{
+			compressedSize = wfLZ_CompressStored( block, stream->blockFill, out, stream->params.swapEndian );
+		}
+		else if( stream->historySize != 0 )
+		{
+			// can't be decompressed without the frames before it
+			( ( wfLZ_Header* )out )->sig[3] = 'S';
+		}
+	}
+	#ifdef WFLZ_STATS
+		if( stream->params.stats != NULL ) wfLZ_AddOutputStats( stream->params.stats, out, stream->params.swapEndian );
+	#endif
+
+	if( total != keep )
+	{
+		wfLZ_MemCpy( stream->buffer, stream->buffer + ( total - keep ), keep ); // forward, so the overlap is fine
+		stream->mf.base += total - keep;
+	}
+	stream->historySize = keep;
+	stream->blockFill = 0;
+
+	// keep room for the next frame's positions, rebasing by a multiple of the window leaves every chain / tree slot where it is
+	if( stream->mf.base > 0x80000000U )
+	{
+		wfLZ_MatchFinderRebase( &stream->mf, ( stream->mf.base - WFLZ_CHAIN_SIZE ) & ~stream->mf.windowMask, stream->strategy );
+	}
+
+	return compressedSize;
+}
+
+//! wfLZ_MatchFinderRebase()
+/*!
+Moves base back by amount, positions that were further back than that become 0 which is always out of reach
+*/
+
+static void wfLZ_MatchFinderRebase( wfLZ_MatchFinder* const mf, const uint32_t amount, const uint32_t strategy )
+{
+	const uint32_t dictSize = 1U << ( 32 - mf->hashShift );
+	uint32_t i;
+	for( i = 0; i != dictSize; ++i )
+	{
+		mf->dict[ i ].pos = mf->dict[ i ].pos >= amount ? mf->dict[ i ].pos - amount : 0;
+	}
+	// chain links are distances, only the tree holds positions
+	if( strategy == WFLZ_STRATEGY_OPTIMAL )
+	{
+		const uint32_t treeSize = ( mf->windowMask + 1 ) * 2;
+		for( i = 0; i != treeSize; ++i )
+		{
+			mf->tree[ i ] = mf->tree[ i ] >= amount ? mf->tree[ i ] - amount : 0;
+		}
+	}
+	mf->base -= amount;
+}
+
+//! wfLZ_StreamCompressorLoadDict()
+
+void wfLZ_StreamCompressorLoadDict( wfLZ_StreamCompressor* const stream, const uint8_t* const dict, const uint32_t dictSize )
+{
+	const uint32_t size = dictSize > stream->params.maxDist ? stream->params.maxDist : dictSize;
+	if( size == 0 ) return;
+	wfLZ_MemCpy( stream->buffer, dict + ( dictSize - size ), size );
+	stream->historySize = size;
+	wfLZ_MatchFinderInsert( &stream->mf, stream->buffer, size, stream->strategy );
+}
+
+//! wfLZ_MatchFinderInsert()
+/*!
+Inserts every position of size bytes at from the way the compressor for strategy would have while compressing them, so the next input can
+match them. Stream frames have long blocks, the tree only takes positions with WFLZ_MAX_MATCH_LEN bytes after them, see wfLZ_TreeFindMatch().
+*/
+
+static void wfLZ_MatchFinderInsert( wfLZ_MatchFinder* const mf, const uint8_t* const from, const uint32_t size, const uint32_t strategy )
+{
+	const uint8_t* pos;
+	const uint8_t* const end = from + size;
+	if( size < WFLZ_MIN_MATCH_LEN ) return;
+
+	if( strategy == WFLZ_STRATEGY_FAST )
+	{
+		for( pos = from; pos <= end - WFLZ_MIN_MATCH_LEN; ++pos )
+		{
+			mf->dict[ WFLZ_HASHPTR( pos, mf->hashShift ) ].pos = mf->base + ( uint32_t )( pos - mf->start );
+		}
+	}
+	else if( strategy == WFLZ_STRATEGY_OPTIMAL )
+	{
+		uint32_t matchDist;
+		#ifdef WFLZ_STATS
+			wfLZ_CompressStats* const stats = mf->stats;
+			mf->stats = NULL; // inserting isn't looking for matches
+		#endif
+		for( pos = from; ( uint32_t )( end - pos ) >= WFLZ_MAX_MATCH_LEN; ++pos )
+		{
+			wfLZ_TreeFindMatch< wfLZ_NativeLongBlocks >( pos, WFLZ_MAX_MATCH_LEN, mf, &matchDist );
+		}
+		#ifdef WFLZ_STATS
+			mf->stats = stats;
+		#endif
+	}
+	else
+	{
+		for( pos = from; pos <= end - WFLZ_MIN_MATCH_LEN; ++pos )
+		{
+			wfLZ_ChainInsert< wfLZ_NativeLongBlocks >( pos, mf );
+		}
+	}
+}
+
+#ifdef WFLZ_STATS
+
+//! wfLZ_AddOutputStats()
+/*!
+Adds up the matches, literals and overhead of the frame the compressor just wrote to out. Counting from the output rather than in each
+compressor's loop gets the same numbers for every strategy, and the compressors only pay for the lookups they count themselves.
+*/
+
+static void wfLZ_AddOutputStats( wfLZ_CompressStats* const stats, const uint8_t* const out, const uint32_t swapEndian )
+{
+	if( out[ 3 ] == wfLZ_NativeShortBlocks::sig )
+	{
+		if( swapEndian != 0 ) wfLZ_AddOutputStatsT< wfLZ_ShortBlocks< wfLZ_SwappedEndian > >( stats, out );
+		else wfLZ_AddOutputStatsT< wfLZ_NativeShortBlocks >( stats, out );
+	}
+	else if( out[ 3 ] == wfLZ_NativeFarBlocks::sig )
+	{
+		if( swapEndian != 0 ) wfLZ_AddOutputStatsT< wfLZ_FarBlocks< wfLZ_SwappedEndian > >( stats, out );
+		else wfLZ_AddOutputStatsT< wfLZ_NativeFarBlocks >( stats, out );
+	}
+	else
+	{
+		if( swapEndian != 0 ) wfLZ_AddOutputStatsT< wfLZ_LongBlocks< wfLZ_SwappedEndian > >( stats, out );
+		else wfLZ_AddOutputStatsT< wfLZ_NativeLongBlocks >( stats, out );
+	}
+}
+
+//! wfLZ_AddOutputStatsT()
+
+template< class F > static void wfLZ_AddOutputStatsT( wfLZ_CompressStats* const stats, const uint8_t* const out )
+{
+	const wfLZ_Header* const header = ( const wfLZ_Header* )out;
+	const uint8_t* src = out + sizeof( wfLZ_Header );
+	uint32_t numLiterals = F::GetNumLiterals( ( const uint8_t* )&header->firstBlock );
+	uint32_t literals = 0;
+
+	if( header->sig[3] == 'R' )
+	{
+		stats->numLiterals += F::Endian::Swap32( header->decompressedSize );
+		stats->blockOverhead += sizeof( wfLZ_Header );
+		return;
+	}
+
+	for( ;; )
+	{
+		uint32_t dist, len;
+
+		src += numLiterals;
+		literals += numLiterals;
+
+		numLiterals = F::GetNumLiterals( src );
+		dist = F::GetDist( src );
+		len = F::GetLength( src );
+		src += F::GetBlockSize( src );
+
+		if( len != 0 )
+		{
+			len += F::minMatchLen - 1;
+			++stats->numMatches;
+			stats->matchBytes += len;
+			++stats->matchLenHist[ wfLZ_Log2( len ) ];
+			++stats->matchDistHist[ wfLZ_Log2( dist ) ];
+		}
+		else if( numLiterals == 0 && dist == 0 )
+		{
+			break;
+		}
+	}
+
+	stats->numLiterals += literals;
+	stats->blockOverhead += ( uint32_t )( src - out ) - literals;
+}
+
+//! wfLZ_Log2()
+
+static uint32_t wfLZ_Log2( uint32_t value )
+{
+	uint32_t log2 = 0;
+	while( value >>= 1 ) ++log2;
+	return log2;
+}
+
+#endif
+
+//! wfLZ_GetCompressDictMemSize()
+
+uint32_t wfLZ_GetCompressDictMemSize( const wfLZ_CompressParams* const params, const uint32_t inSize )
+{
+	return wfLZ_GetStreamCompressorSize( params, inSize != 0 ? inSize : 1 );
+}
+
+//! wfLZ_CompressDict()
+/*!
+A stream of one frame, with the dictionary as the history before it
+*/
+
+uint32_t wfLZ_CompressDict( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, uint8_t* const mem, const wfLZ_CompressParams* const params, const uint8_t* const dict, const uint32_t dictSize )
+{
+	wfLZ_StreamCompressor* const stream = wfLZ_StreamCompressorInit( mem, params, inSize != 0 ? inSize : 1 );
+	uint32_t inUsed;
+	if( inSize == 0 )
+	{
+		return wfLZ_CompressStored( in, 0, out, stream->params.swapEndian );
+	}
+	wfLZ_StreamCompressorLoadDict( stream, dict, dictSize );
+	return wfLZ_StreamCompress( stream, in, inSize, &inUsed, out, wfLZ_GetMaxCompressedSize( inSize ), 1 );
+}
+
+//! wfLZ_GetStreamDecompressorSize()
+
+uint32_t wfLZ_GetStreamDecompressorSize()
+{
+	return sizeof( wfLZ_StreamDecompressor );
+}
+
+//! wfLZ_StreamDecompressorInit()
+
+wfLZ_StreamDecompressor* wfLZ_StreamDecompressorInit( uint8_t* const mem, uint8_t* const ring, const uint32_t ringSize )
+{
+	wfLZ_StreamDecompressor* const stream = ( wfLZ_StreamDecompressor* )mem;
+	if( ringSize < WFLZ_STREAM_MIN_RING_SIZE ) return NULL;
+	wfLZ_MemSet( mem, 0, sizeof( wfLZ_StreamDecompressor ) );
+	stream->ring = ring;
+	stream->ringSize = ringSize;
+	// wide copies write up to WFLZ_WILDCOPY_MAX_SIZE-1 bytes past the end of what they copy, into the oldest bytes in the ring -- fine as long as no
+	// match can reach that far back
+	stream->wide = ringSize >= WFLZ_MAX_MATCH_DIST + WFLZ_WILDCOPY_MAX_SIZE;
+	stream->state = WFLZ_STREAM_HEADER;
+	return stream;
+}
+
+//! wfLZ_StreamDecompressorLoadDict()
+/*!
+The end of the dictionary goes in the ring as history that has already been consumed
+*/
+
+void wfLZ_StreamDecompressorLoadDict( wfLZ_StreamDecompressor* const stream, const uint8_t* const dict, const uint32_t dictSize )
+{
+	const uint32_t size = dictSize > stream->ringSize ? stream->ringSize : dictSize;
+	if( size == 0 ) return;
+	wfLZ_MemCpy( stream->ring, dict + ( dictSize - size ), size );
+	stream->writePos = size == stream->ringSize ? 0 : size;
+	stream->readPos = stream->writePos;
+	stream->history = size;
+}
+
+//! wfLZ_StreamDecompress()
+/*!
+A state machine that can stop anywhere: between blocks while far from the end of the input, the frame and the free part of the ring it runs
+DecompressWide() straight into the ring, everything else goes a piece at a time and wraps around the ring.
+*/
+
+int32_t wfLZ_StreamDecompress( wfLZ_StreamDecompressor* const stream, const uint8_t* const in, const uint32_t inSize, uint32_t* const inUsed )
+{
+	const uint8_t* src = in;
+	const uint8_t* const srcEnd = in + inSize;
+	uint8_t* const ring = stream->ring;
+	const uint32_t ringSize = stream->ringSize;
+	int32_t result = stream->error;
+
+	while( result == WFLZ_OK )
+	{
+		const uint32_t space = ringSize - stream->unread;
+		const uint32_t inLeft = ( uint32_t )( srcEnd - src );
+		// a standalone frame can't reach before its own output
+		const uint32_t reach = stream->header.sig[3] == 'S' ? stream->history : stream->frameOut;
+		uint32_t count;
+
+		if(
+			stream->wide != 0
+			&&
+			( stream->state == WFLZ_STREAM_LITERALS || ( stream->state == WFLZ_STREAM_BLOCK && stream->partial == 0 ) )
+			&&
+			inLeft >= WFLZ_WILDCOPY_IN_MARGIN && stream->header.compressedSize - stream->frameIn >= WFLZ_WILDCOPY_IN_MARGIN
+			&&
+			space >= WFLZ_WILDCOPY_OUT_MARGIN && ringSize - stream->writePos >= WFLZ_WILDCOPY_OUT_MARGIN
+		)
+		{
+			const uint8_t* wideSrc = src;
+			uint8_t* const dstStart = ring + stream->writePos;
+			uint8_t* dst = dstStart;
+			uint8_t numLiterals = ( uint8_t )( stream->state == WFLZ_STREAM_LITERALS ? stream->count : 0 );
+			uint32_t room = ringSize - stream->writePos;
+			int32_t wide;
+			if( room > space ) room = space;
+			if( room > stream->header.decompressedSize - stream->frameOut ) room = stream->header.decompressedSize - stream->frameOut;
+
+			wide = wfLZ_DecompressWide< wfLZ_NativeLongBlocks >(
+				&wideSrc, &dst, &numLiterals,
+				src + ( inLeft < stream->header.compressedSize - stream->frameIn ? inLeft : stream->header.compressedSize - stream->frameIn ),
+				dstStart - ( stream->writePos < reach ? stream->writePos : reach ),
+				dstStart + room,
+				1
+			);
+			if( wideSrc != src )
+			{
+				stream->frameIn += ( uint32_t )( wideSrc - src );
+				src = wideSrc;
+				wfLZ_StreamAdvance( stream, ( uint32_t )( dst - dstStart ) );
+				if( wide == 1 )
+				{
+					result = wfLZ_StreamEndFrame( stream );
+				}
+				else if( wide == 0 )
+				{
+					stream->count = numLiterals;
+					stream->state = WFLZ_STREAM_LITERALS;
+				}
+				else
+				{
+					// a match that wraps around the ring or reaches too far, sorted out below
+					stream->count = 0;
+					stream->state = WFLZ_STREAM_BLOCK;
+				}
+				continue;
+			}
+		}
+
+		switch( stream->state )
+		{
+			case WFLZ_STREAM_HEADER:
+			{
+				count = sizeof( wfLZ_Header ) - stream->partial;
+				if( count > inLeft ) count = inLeft;
+				if( count == 0 ) goto WF_LZ_STREAM_OUT;
+				wfLZ_MemCpy( stream->pending + stream->partial, src, count );
+				stream->partial += count;
+				src += count;
+				if( stream->partial != sizeof( wfLZ_Header ) ) goto WF_LZ_STREAM_OUT;
+				stream->partial = 0;
+				stream->header = *( const wfLZ_Header* )stream->pending;
+				stream->frameIn = 0;
+				stream->frameOut = 0;
+				if( !( stream->header.sig[0] == 'W' && stream->header.sig[1] == 'F' && stream->header.sig[2] == 'L' && ( stream->header.sig[3] == 'Z' || stream->header.sig[3] == 'R' || stream->header.sig[3] == 'S' ) ) )
+				{
+					result = WFLZ_ERROR_BAD_HEADER;
+				}
+				else if( stream->header.sig[3] == 'R' )
+				{
+					if( stream->header.compressedSize != stream->header.decompressedSize ) result = WFLZ_ERROR_CORRUPT;
+					stream->count = stream->header.decompressedSize;
+					stream->state = WFLZ_STREAM_STORED;
+				}
+				else
+				{
+					result = wfLZ_StreamBeginLiterals( stream, stream->header.firstBlock.numLiterals );
+				}
+				break;
+			}
+
+			case WFLZ_STREAM_STORED:
+			case WFLZ_STREAM_LITERALS:
+			{
+				if( stream->count == 0 )
+				{
+					if( stream->state == WFLZ_STREAM_STORED )
+					{
+						stream->frameIn = stream->frameOut;
+						result = wfLZ_StreamEndFrame( stream );
+					}
+					else
+					{
+						stream->state = WFLZ_STREAM_BLOCK;
+					}
+					break;
+				}
+				if( space == 0 ) { result = WFLZ_STREAM_RING_FULL; break; }
+				count = stream->count;
+				if( count > inLeft ) count = inLeft;
+				if( count > space ) count = space;
+				if( count > ringSize - stream->writePos ) count = ringSize - stream->writePos;
+				if( count == 0 ) goto WF_LZ_STREAM_OUT;
+				wfLZ_MemCpy( ring + stream->writePos, src, count );
+				src += count;
+				stream->count -= count;
+				if( stream->state == WFLZ_STREAM_LITERALS ) stream->frameIn += count;
+				wfLZ_StreamAdvance( stream, count );
+				break;
+			}
+
+			case WFLZ_STREAM_BLOCK:
+			{
+				const wfLZ_Block* const block = ( const wfLZ_Block* )stream->pending;
+				uint32_t len;
+				count = WFLZ_BLOCK_SIZE - stream->partial;
+				if( count > inLeft ) count = inLeft;
+				if( count == 0 ) goto WF_LZ_STREAM_OUT;
+				wfLZ_MemCpy( stream->pending + stream->partial, src, count );
+				stream->partial += count;
+				src += count;
+				if( stream->partial != WFLZ_BLOCK_SIZE ) goto WF_LZ_STREAM_OUT;
+				stream->partial = 0;
+				stream->frameIn += WFLZ_BLOCK_SIZE;
+				if( stream->frameIn > stream->header.compressedSize ) { result = WFLZ_ERROR_CORRUPT; break; }
+
+				stream->dist = wfLZ_GetBlockDist( block );
+				stream->numLiterals = block->numLiterals;
+				len = block->length;
+				if( len != 0 )
+				{
+					len += WFLZ_MIN_MATCH_LEN - 1;
+					if( stream->dist - 1 >= reach || len > stream->header.decompressedSize - stream->frameOut )
+					{
+						result = WFLZ_ERROR_CORRUPT;
+						break;
+					}
+					stream->count = len;
+					stream->state = WFLZ_STREAM_MATCH;
+				}
+				else if( stream->numLiterals == 0 && stream->dist == 0 )
+				{
+					result = wfLZ_StreamEndFrame( stream );
+				}
+				else
+				{
+					result = wfLZ_StreamBeginLiterals( stream, stream->numLiterals );
+				}
+				break;
+			}
+
+			case WFLZ_STREAM_MATCH:
+			{
+				// copied forward a byte at a time by wfLZ_MemCpy(), so a match overlapping itself repeats like it should
+				const uint32_t from = stream->writePos >= stream->dist ? stream->writePos - stream->dist : stream->writePos + ringSize - stream->dist;
+				if( space == 0 ) { result = WFLZ_STREAM_RING_FULL; break; }
+				count = stream->count;
+				if( count > space ) count = space;
+				if( count > ringSize - stream->writePos ) count = ringSize - stream->writePos;
+				if( count > ringSize - from ) count = ringSize - from;
+				wfLZ_MemCpy( ring + stream->writePos, ring + from, count );
+				stream->count -= count;
+				wfLZ_StreamAdvance( stream, count );
+				if( stream->count == 0 ) result = wfLZ_StreamBeginLiterals( stream, stream->numLiterals );
+				break;
+			}
+		}
+	}
+
+	if( result < 0 ) stream->error = result;
+
+WF_LZ_STREAM_OUT:
+	*inUsed = ( uint32_t )( src - in );
+	return result;
+}
+
+//! wfLZ_StreamDecompressGetOutput()
+
+uint32_t wfLZ_StreamDecompressGetOutput( const wfLZ_StreamDecompressor* const stream, const uint8_t** const data )
+{
+	const uint32_t toEnd = stream->ringSize - stream->readPos;
+	*data = stream->ring + stream->readPos;
+	return stream->unread < toEnd ? stream->unread : toEnd;
+}
+
+//! wfLZ_StreamDecompressConsume()
+
+void wfLZ_StreamDecompressConsume( wfLZ_StreamDecompressor* const stream, const uint32_t size )
+{
+	const uint32_t count = size < stream->unread ? size : stream->unread;
+	stream->readPos += count;
+	if( stream->readPos >= stream->ringSize ) stream->readPos -= stream->ringSize;
+	stream->unread -= count;
+}
+
+//! wfLZ_StreamDecompressEnd()
+
+int32_t wfLZ_StreamDecompressEnd( const wfLZ_StreamDecompressor* const stream )
+{
+	if( stream->error != WFLZ_OK ) return stream->error;
+	return stream->state == WFLZ_STREAM_HEADER && stream->partial == 0 ? WFLZ_OK : WFLZ_ERROR_INPUT_OVERRUN;
+}
+
+//! wfLZ_StreamAdvance()
+/*!
+count bytes were just written at writePos
+*/
+
+static inline void wfLZ_StreamAdvance( wfLZ_StreamDecompressor* const stream, const uint32_t count )
+{
+	stream->writePos += count;
+	if( stream->writePos == stream->ringSize ) stream->writePos = 0;
+	stream->unread += count;
+	stream->frameOut += count;
+	stream->history = stream->ringSize - stream->history > count ? stream->history + count : stream->ringSize;
+}
+
+//! wfLZ_StreamBeginLiterals()
+/*!
+Checks that count literals fit in what is left of the frame, on both sides
+*/
+
+static inline int32_t wfLZ_StreamBeginLiterals( wfLZ_StreamDecompressor* const stream, const uint32_t count )
+{
+	if( count > stream->header.compressedSize - stream->frameIn ) return WFLZ_ERROR_INPUT_OVERRUN;
+	if( count > stream->header.decompressedSize - stream->frameOut ) return WFLZ_ERROR_CORRUPT;
+	stream->count = count;
+	stream->state = WFLZ_STREAM_LITERALS;
+	return WFLZ_OK;
+}
+
+//! wfLZ_StreamEndFrame()
+/*!
+The next frame starts right after this one, so the header has to have told the truth about both sizes
+*/
+
+static inline int32_t wfLZ_StreamEndFrame( wfLZ_StreamDecompressor* const stream )
+{
+	stream->state = WFLZ_STREAM_HEADER;
+	return stream->frameIn == stream->header.compressedSize && stream->frameOut == stream->header.decompressedSize ? WFLZ_OK : WFLZ_ERROR_CORRUPT;
+}
+
+/*!
+Utility functions below, not exposed publicly
+
+Thanks Daniel A. Newby (Corwinoid) for optimizing these!
+*/
+
+//! wfLZ_MemCmp()
+/*!
+Deceptively named: the return value of this is *not* like strcmp/memcmp() -- it's just the number of sequential matching bytes, not some kind of diff
+Compares WFLZ_MATCH_LEN_SIZE bytes at a time while that many are left, then 8 / 4 at a time and byte by byte, never reading past maxLen
+Depends on unaligned access unless WFLZ_MATCH_LEN_SIZE is 1, but it is only called during Compress() which has other issues on CPUs that care
+*/
+
+static inline uint32_t wfLZ_MemCmp( const uint8_t* a, const uint8_t* b, const uint32_t maxLen )
+{
+	uint32_t len = 0;
+
+	#if WFLZ_MATCH_LEN_SIZE == 32
+		while( maxLen - len >= 32 )
+		{
+			const __m256i eq = _mm256_cmpeq_epi8( _mm256_loadu_si256( ( const __m256i* )( a + len ) ), _mm256_loadu_si256( ( const __m256i* )( b + len ) ) );
+			const uint32_t diff = ~( uint32_t )_mm256_movemask_epi8( eq );
+			if( diff != 0 ) return len + wfLZ_Ctz32( diff );
+			len += 32;
+		}
+	#elif WFLZ_MATCH_LEN_SIZE == 16
+		while( maxLen - len >= 16 )
+		{
+			const __m128i eq = _mm_cmpeq_epi8( _mm_loadu_si128( ( const __m128i* )( a + len ) ), _mm_loadu_si128( ( const __m128i* )( b + len ) ) );
+			const uint32_t diff = ~( uint32_t )_mm_movemask_epi8( eq ) & 0xffff;
+			if( diff != 0 ) return len + wfLZ_Ctz32( diff );
+			len += 16;
+		}
+	#endif
+
+	#if WFLZ_MATCH_LEN_SIZE >= 8
+		while( maxLen - len >= 8 )
+		{
+			const uint64_t diff = *( const uint64_t* )( a + len ) ^ *( const uint64_t* )( b + len );
+			if( diff != 0 ) return len + wfLZ_FirstDiff64( diff );
+			len += 8;
+		}
+	#endif
+
+	#if WFLZ_MATCH_LEN_SIZE >= 4
+		while( maxLen - len >= 4 )
+		{
+			const uint32_t diff = *( const uint32_t* )( a + len ) ^ *( const uint32_t* )( b + len );
+			if( diff != 0 ) return len + wfLZ_FirstDiff32( diff );
+			len += 4;
+		}
+	#endif
+
+	while( len != maxLen && a[ len ] == b[ len ] ) ++len;
+	return len;
+}
+
+//! wfLZ_FirstDiff32()
+/*!
+Index of the first byte in memory order that is non-zero in the xor of two loads, diff must not be 0
+*/
+
+static inline uint32_t wfLZ_FirstDiff32( const uint32_t diff )
+{
+	#ifdef WFLZ_BIG_ENDIAN
+		return ( uint32_t )__builtin_clz( diff ) >> 3;
+	#else
+		return wfLZ_Ctz32( diff ) >> 3;
+	#endif
+}
+
+//! wfLZ_FirstDiff64()
+
+static inline uint32_t wfLZ_FirstDiff64( const uint64_t diff )
+{
+	#if defined( WFLZ_BIG_ENDIAN )
+		return ( uint32_t )__builtin_clzll( diff ) >> 3;
+	#elif defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_ARM64 ) )
+		unsigned long idx;
+		_BitScanForward64( &idx, diff );
+		return ( uint32_t )idx >> 3;
+	#elif defined( _MSC_VER )
+		const uint32_t low = ( uint32_t )diff;
+		return low != 0 ? wfLZ_Ctz32( low ) >> 3 : 4 + ( wfLZ_Ctz32( ( uint32_t )( diff >> 32 ) ) >> 3 );
+	#else
+		return ( uint32_t )__builtin_ctzll( diff ) >> 3;
+	#endif
+}
+
+//! wfLZ_Ctz32()
+/*!
+Number of trailing zero bits, mask must not be 0
+*/
+
+static inline uint32_t wfLZ_Ctz32( const uint32_t mask )
+{
+	#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanForward( &idx, mask );
+		return ( uint32_t )idx;
+	#else
+		return ( uint32_t )__builtin_ctz( mask );
 	#endif
+}
+
+//! wfLZ_MemCpy()
+
+void wfLZ_MemCpy( uint8_t* dst, const uint8_t* src, const uint32_t size )
+{
+#if 0
+	uint32_t i;
+	for( i = 0; i != size; ++i ) *dst++ = *src++;
+#else
+	int32_t n = (size+7) / 8;
+	switch( size % 8 )
+	{
+		case 0: do {    *dst++ = *src++;
+		case 7:         *dst++ = *src++;
+		case 6:         *dst++ = *src++;
+		case 5:         *dst++ = *src++;
+		case 4:         *dst++ = *src++;
+		case 3:         *dst++ = *src++;
+		case 2:         *dst++ = *src++;
+		case 1:         *dst++ = *src++;
+		} while(--n > 0);
+	}
+#endif
+}
+
+//! wfLZ_MemSet()
+
+void wfLZ_MemSet( uint8_t* dst, const uint8_t value, const uint32_t size )
+{
+	uint32_t i;
+	for( i = 0; i != size; ++i ) *dst++ = value;
+}
+
+//! wfLZ_CopyStored()
+/*!
+Exactly size bytes, wide while it can
+*/
+
+static inline void wfLZ_CopyStored( uint8_t* dst, const uint8_t* src, const uint32_t size )
+{
+	const uint32_t wide = size & ~( WFLZ_WILDCOPY_SIZE - 1 );
+	if( wide != 0 ) wfLZ_WildCopy< WFLZ_WILDCOPY_SIZE >( dst, src, dst + wide );
+	if( size != wide ) wfLZ_MemCpy( dst + wide, src + wide, size - wide );
+}
+
+//! wfLZ_GetBlockDist()
+
+static inline uint16_t wfLZ_GetBlockDist( const wfLZ_Block* const block )
+{
+	return wfLZ_Load16( ( const uint8_t* )&block->dist );
+}
+
+//! wfLZ_Read32()
+/*! A header field, swapped if the data came from a machine of the other byte order */
+
+static inline uint32_t wfLZ_Read32( const uint32_t value, const uint32_t swapped )
+{
+	return swapped != 0 ? wfLZ_SwappedEndian::Swap32( value ) : value;
+}
 
-WF_LZ_BLOCK:
-	block = ( wfLZ_Block* )src;
-	numLiterals = block->numLiterals;
+//! wfLZ_Load16()
+
+static inline uint16_t wfLZ_Load16( const uint8_t* const src )
+{
 	#ifdef SPU // compensate for unaligned u16 reads
-		( (uint8_t*)&dist )[ 0 ] = ( (uint8_t*)&block->dist )[ 0 ];
-		( (uint8_t*)&dist )[ 1 ] = ( (uint8_t*)&block->dist )[ 1 ];
+		uint16_t value;
+		( (uint8_t*)&value )[ 0 ] = src[ 0 ];
+		( (uint8_t*)&value )[ 1 ] = src[ 1 ];
+		return value;
 	#else
-		dist = block->dist;
+		return *( const uint16_t* )src;
 	#endif
-	len = ( uint16_t )block->length;
+}
 
-	if( len != 0 )
-	{
-		len += WFLZ_MIN_MATCH_LEN - 1;
-		WF_LZ_DBG_PRINT( "  backtrack [%u] len [%u]\n", dist, len );
-		wfLZ_MemCpy( dst, dst - dist, len );
-		dst += len;
-	}
-	src += WFLZ_BLOCK_SIZE;
+//! wfLZ_Store16()
 
-	if( numLiterals == 0 )
+static inline void wfLZ_Store16( uint8_t* const dst, const uint16_t value )
+{
+	#ifdef SPU // and writes
+		dst[ 0 ] = ( (const uint8_t*)&value )[ 0 ];
+		dst[ 1 ] = ( (const uint8_t*)&value )[ 1 ];
+	#else
+		*( uint16_t* )dst = value;
+	#endif
+}
+
+//! wfLZ_CopyWide()
+/*!
+Copies width bytes, the widths past WFLZ_WILDCOPY_SIZE are only instantiated when dispatching, inside the kernel compiled for their instruction set
+*/
+
+template<> inline void wfLZ_CopyWide< 8 >( uint8_t* const dst, const uint8_t* const src )
+{
+	dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3];
+	dst[4] = src[4]; dst[5] = src[5]; dst[6] = src[6]; dst[7] = src[7];
+}
+
+#if WFLZ_WILDCOPY_MAX_SIZE >= 16
+template<> WFLZ_TARGET( "sse2" ) inline void wfLZ_CopyWide< 16 >( uint8_t* const dst, const uint8_t* const src )
+{
+	_mm_storeu_si128( ( __m128i* )dst, _mm_loadu_si128( ( const __m128i* )src ) );
+}
+#endif
+
+#if WFLZ_WILDCOPY_MAX_SIZE == 32
+template<> WFLZ_TARGET( "avx2" ) inline void wfLZ_CopyWide< 32 >( uint8_t* const dst, const uint8_t* const src )
+{
+	_mm256_storeu_si256( ( __m256i* )dst, _mm256_loadu_si256( ( const __m256i* )src ) );
+}
+#endif
+
+//! wfLZ_WildCopy()
+/*!
+Copies width bytes at a time until dstEnd is reached, so it may write up to width-1 bytes past dstEnd (and read as far past src)
+src must be at least width bytes behind dst if the two overlap
+*/
+
+template< uint32_t width > static inline void wfLZ_WildCopy( uint8_t* dst, const uint8_t* src, const uint8_t* const dstEnd )
+{
+	while( dst < dstEnd )
 	{
-		if( dist == 0 && len == 0 )	// we've reached the end of the input
-		{
-			WF_LZ_DBG_SHUTDOWN
-			return;
-		}
-		goto WF_LZ_BLOCK;
+		wfLZ_CopyWide< width >( dst, src );
+		dst += width;
+		src += width;
 	}
-	else
+}
+
+//! wfLZ_WildCopyMatch()
+/*!
+Same output as wfLZ_MemCpy( dst, dst - dist, len ), but may write up to width-1 bytes past dst + len
+Matches closer than width overlap themselves, see wfLZ_PatternFill()
+*/
+
+template< uint32_t width > static inline void wfLZ_WildCopyMatch( uint8_t* dst, const uint32_t dist, const uint32_t len )
+{
+	if( dist < width )
 	{
-		goto WF_LZ_LITERALS;
+		wfLZ_PatternFill< width >( dst, dist, dst + len );
+		return;
 	}
+	wfLZ_WildCopy< width >( dst, dst - dist, dst + len );
 }
 
-//! wfLZ_GetHeaderSize()
+//! wfLZ_PatternFill()
+/*!
+A match closer than width repeats every dist bytes. Periods of 1, 2, 4 and 8 bytes -- runs of one byte, what CompressFast() writes for transparent
+areas, and repeated DXT blocks -- are broadcast into a register and stored over and over without reading the output back. Any other period has
+a few bytes laid down one at a time, then the rest is copied wide from a whole number of periods back. Writes up to width-1 bytes past dstEnd
+*/
 
-uint32_t wfLZ_GetHeaderSize( const uint8_t* const in )
+template< uint32_t width > static inline void wfLZ_PatternFill( uint8_t* dst, const uint32_t dist, const uint8_t* const dstEnd )
 {
-	if( in[0] == 'Z' && in[1] == 'L' && in[2] == 'F' && in[3] == 'W' )
+	const uint8_t* match = dst - dist;
+	if( width > 8 && dist <= 8 && ( dist & ( dist - 1 ) ) == 0 )
 	{
-		const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* )in;
-		return sizeof( wfLZ_HeaderChunked ) + sizeof( wfLZ_ChunkDesc )*header->numChunks;
+		// the product repeats the bytes in the order they are in memory, whatever the byte order
+		const uint64_t value =
+			dist == 1 ? match[ 0 ] * 0x0101010101010101ULL :
+			dist == 2 ? wfLZ_Load16( match ) * 0x0001000100010001ULL :
+			dist == 4 ? *( const uint32_t* )match * 0x0000000100000001ULL :
+			*( const uint64_t* )match;
+		wfLZ_FillWide< width >( dst, dstEnd, value );
+		return;
 	}
-	if( in[0] == 'W' && in[1] == 'F' && in[2] == 'L' && in[3] == 'Z' )
 	{
-		return sizeof( wfLZ_Header );
+		const uint32_t patternDist = dist * ( ( width + dist - 1 ) / dist );
+		const uint8_t* const patternEnd = dst + ( patternDist - dist );
+		while( dst != patternEnd ) *dst++ = *match++;
+		wfLZ_WildCopy< width >( dst, dst - patternDist, dstEnd );
 	}
-	return 0;
 }
 
-//! LZC_GetMaxChunkCompressedSize()
+//! wfLZ_FillWide()
+/*!
+Stores the 8 bytes of value over and over, width bytes at a time, until dstEnd is reached -- so up to width-1 bytes past it
+Only PatternFill() on the SIMD widths uses this, 8 is there so it compiles
+*/
 
-uint32_t wfLZ_GetMaxChunkCompressedSize( const uint32_t inSize, const uint32_t blockSize )
+template<> inline void wfLZ_FillWide< 8 >( uint8_t* dst, const uint8_t* const dstEnd, const uint64_t value )
 {
-	const uint32_t numChunks = ( (inSize-1) / blockSize ) + 1;
-	return
-		wfLZ_RoundUp( wfLZ_GetMaxCompressedSize( blockSize ), WFLZ_CHUNK_PAD )*numChunks
-		+
-		wfLZ_RoundUp( sizeof( wfLZ_ChunkDesc ) * numChunks, WFLZ_CHUNK_PAD )
-		+
-		sizeof( wfLZ_HeaderChunked )
-	;
+	for( ; dst < dstEnd; dst += 8 ) wfLZ_CopyWide< 8 >( dst, ( const uint8_t* )&value );
 }
 
-//! LZC_ChunkCompress()
+#if WFLZ_WILDCOPY_MAX_SIZE >= 16
+template<> WFLZ_TARGET( "sse2" ) inline void wfLZ_FillWide< 16 >( uint8_t* dst, const uint8_t* const dstEnd, const uint64_t value )
+{
+	const __m128i pattern = _mm_set1_epi64x( ( long long )value );
+	for( ; dst < dstEnd; dst += 16 ) _mm_storeu_si128( ( __m128i* )dst, pattern );
+}
+#endif
 
-uint32_t wfLZ_ChunkCompress( uint8_t* in, const uint32_t inSize, const uint32_t blockSize, uint8_t* out, const uint8_t* workMem, const uint32_t swapEndian, const uint32_t useFastCompress )
+#if WFLZ_WILDCOPY_MAX_SIZE == 32
+template<> WFLZ_TARGET( "avx2" ) inline void wfLZ_FillWide< 32 >( uint8_t* dst, const uint8_t* const dstEnd, const uint64_t value )
 {
-	wfLZ_HeaderChunked* header;
-	wfLZ_ChunkDesc* block;
-	uint32_t bytesLeft;
+	const __m256i pattern = _mm256_set1_epi64x( ( long long )value );
+	for( ; dst < dstEnd; dst += 32 ) _mm256_storeu_si256( ( __m256i* )dst, pattern );
+}
+#endif
 
-	const uint32_t numChunks = ( (inSize-1) / blockSize ) + 1;
-	uint32_t totalCompressedSize = 0;
+//! wfLZ_DecompressWide()
+/*!
+The unchecked inner loop of Decompress() and DecompressSafe(), it runs while both cursors are far enough from srcEnd / dstEnd for the wide copies
+Returns 1 if the end block was reached, otherwise 0 and *srcPtr, *dstPtr and *numLiteralsPtr are left where the caller's narrow loop has to pick up
+checkDist != 0 returns WFLZ_ERROR_CORRUPT for matches reaching before out instead of trusting them, *srcPtr is left at the block of the match
+so a caller that can reach further back than out (the stream decoder, around the end of its ring) can still decode it
+When dispatching, this goes through the kernel for the CPU's widest copy, picked the first time through (for each block format)
+*/
 
-	header = ( wfLZ_HeaderChunked* )out;
-	block = ( wfLZ_ChunkDesc* )( out+sizeof( wfLZ_HeaderChunked ) );
-	totalCompressedSize += wfLZ_RoundUp( sizeof( wfLZ_HeaderChunked ) + sizeof( wfLZ_ChunkDesc )*numChunks, WFLZ_CHUNK_PAD );
-	out += totalCompressedSize;
+template< class F > static inline int32_t wfLZ_DecompressWide( const uint8_t** srcPtr, uint8_t** dstPtr, uint8_t* numLiteralsPtr, const uint8_t* const srcEnd, const uint8_t* const out, const uint8_t* const dstEnd, const uint32_t checkDist )
+{
+	#ifdef WFLZ_DISPATCH
+		static const wfLZ_DecompressWideFunc kernel = wfLZ_SelectDecompressWide< F >();
+		return kernel( srcPtr, dstPtr, numLiteralsPtr, srcEnd, out, dstEnd, checkDist );
+	#else
+		return wfLZ_DecompressWideT< WFLZ_WILDCOPY_SIZE, F >( srcPtr, dstPtr, numLiteralsPtr, srcEnd, out, dstEnd, checkDist );
+	#endif
+}
 
-	for( bytesLeft = inSize; bytesLeft != 0; /**/ )
+//! wfLZ_DecompressWideT()
+
+template< uint32_t width, class F > static inline int32_t wfLZ_DecompressWideT( const uint8_t** srcPtr, uint8_t** dstPtr, uint8_t* numLiteralsPtr, const uint8_t* const srcEnd, const uint8_t* const out, const uint8_t* const dstEnd, const uint32_t checkDist )
+{
+	const uint8_t* src = *srcPtr;
+	uint8_t* dst = *dstPtr;
+	uint32_t numLiterals = *numLiteralsPtr;
+	int32_t result = 0;
+
+	while( ( uint32_t )( dstEnd - dst ) >= WFLZ_WILDCOPY_OUT_MARGIN && ( uint32_t )( srcEnd - src ) >= WFLZ_WILDCOPY_IN_MARGIN )
 	{
-		const uint32_t decompressedSize = bytesLeft >= blockSize ? blockSize : bytesLeft ;
-		const uint32_t compressedSize = wfLZ_RoundUp(
-			useFastCompress == 0 ? wfLZ_Compress( in, decompressedSize, out, workMem, swapEndian ) : wfLZ_CompressFast( in, decompressedSize, out, workMem, swapEndian ),
-			WFLZ_CHUNK_PAD
-		);
-		block->offset = totalCompressedSize;
+		uint32_t dist, len, blockSize;
 
-		if( swapEndian != 0 )
+		wfLZ_WildCopy< width >( dst, src, dst + numLiterals );
+		src += numLiterals;
+		dst += numLiterals;
+
+		numLiterals = F::GetNumLiterals( src );
+		dist = F::GetDist( src );
+		len = F::GetLength( src );
+		blockSize = F::GetBlockSize( src );
+		src += blockSize;
+
+		if( len != 0 )
 		{
-			wfLZ_EndianSwap32( &block->offset );
+			len += F::minMatchLen - 1;
+			if( checkDist != 0 && dist - 1 >= ( uint32_t )( dst - out ) )
+			{
+				src -= blockSize;
+				numLiterals = 0;
+				result = WFLZ_ERROR_CORRUPT;
+				break;
+			}
+			wfLZ_WildCopyMatch< width >( dst, dist, len );
+			dst += len;
+		}
+		else if( numLiterals == 0 && dist == 0 ) // we've reached the end of the input
+		{
+			result = 1;
+			break;
 		}
-
-		++block;
-		bytesLeft           -= decompressedSize;
-		in                  += decompressedSize;
-		out                 += compressedSize;
-		totalCompressedSize += compressedSize;
 	}
 
-	header->sig[0]           = 'Z';
-	header->sig[1]           = 'L';
-	header->sig[2]           = 'F';
-	header->sig[3]           = 'W';
-	header->decompressedSize = inSize;
-	header->numChunks        = numChunks;
-	header->compressedSize   = totalCompressedSize - sizeof( wfLZ_HeaderChunked );
-	if( swapEndian != 0 )
-	{
-		wfLZ_EndianSwap32( &header->decompressedSize );
-		wfLZ_EndianSwap32( &header->compressedSize );
-		wfLZ_EndianSwap32( &header->numChunks );
-	}
+	*srcPtr = src;
+	*dstPtr = dst;
+	*numLiteralsPtr = ( uint8_t )numLiterals;
+	return result;
+}
 
-	return totalCompressedSize;
+//! wfLZ_GetCopyWidth()
+
+uint32_t wfLZ_GetCopyWidth()
+{
+	#ifdef WFLZ_DISPATCH
+		static const uint32_t width = wfLZ_DetectCopyWidth();
+		return width;
+	#else
+		return WFLZ_WILDCOPY_SIZE;
+	#endif
 }
 
-//! wfLZ_GetNumChunks()
+#ifdef WFLZ_DISPATCH
 
-uint32_t wfLZ_GetNumChunks( const uint8_t* const in )
+//! wfLZ_SelectDecompressWide()
+
+template< class F > static wfLZ_DecompressWideFunc wfLZ_SelectDecompressWide()
 {
-	const wfLZ_HeaderChunked* const header = ( const wfLZ_HeaderChunked* const )in;
-	if( header->sig[0] == 'Z' && header->sig[1] == 'L' && header->sig[2] == 'F' && header->sig[3] == 'W' )
+	switch( wfLZ_GetCopyWidth() )
 	{
-		return header->numChunks;
+		case 32: return wfLZ_DecompressWideAVX2< F >;
+		case 16: return wfLZ_DecompressWideSSE2< F >;
+		default: return wfLZ_DecompressWideT< WFLZ_WILDCOPY_SIZE, F >;
 	}
-	return 0;
 }
 
-//! wfLZ_ChunkDecompressCallback()
+//! wfLZ_DecompressWideAVX2()
+/*!
+wfLZ_DecompressWideT() built for AVX2, flatten pulls the copies into this function so they're compiled for it too (they can't be inlined into code built without it)
+*/
 
-void wfLZ_ChunkDecompressCallback( uint8_t* in, void( *chunkCallback )( void* ) )
+template< class F > WFLZ_TARGET( "avx2" ) WFLZ_FLATTEN static int32_t wfLZ_DecompressWideAVX2( const uint8_t** srcPtr, uint8_t** dstPtr, uint8_t* numLiteralsPtr, const uint8_t* const srcEnd, const uint8_t* const out, const uint8_t* const dstEnd, const uint32_t checkDist )
 {
-	uint32_t chunkIdx;
-	//wfLZ_ChunkDesc* chunk;
-	wfLZ_HeaderChunked* header = ( wfLZ_HeaderChunked* )in;
-	const uint32_t numChunks = header->numChunks;
-	in += sizeof( wfLZ_HeaderChunked );
+	return wfLZ_DecompressWideT< 32, F >( srcPtr, dstPtr, numLiteralsPtr, srcEnd, out, dstEnd, checkDist );
+}
 
-	//chunk = ( wfLZ_ChunkDesc* )in;
-	in += sizeof( wfLZ_ChunkDesc ) * numChunks;
+//! wfLZ_DecompressWideSSE2()
 
-	for( chunkIdx = 0; chunkIdx != numChunks; ++chunkIdx )
-	{
-		chunkCallback( in );
-		in += wfLZ_RoundUp( wfLZ_GetCompressedSize( in ), WFLZ_CHUNK_PAD );
-	}
+template< class F > WFLZ_TARGET( "sse2" ) WFLZ_FLATTEN static int32_t wfLZ_DecompressWideSSE2( const uint8_t** srcPtr, uint8_t** dstPtr, uint8_t* numLiteralsPtr, const uint8_t* const srcEnd, const uint8_t* const out, const uint8_t* const dstEnd, const uint32_t checkDist )
+{
+	return wfLZ_DecompressWideT< 16, F >( srcPtr, dstPtr, numLiteralsPtr, srcEnd, out, dstEnd, checkDist );
 }
 
-//! wfLZ_ChunkDecompressLoop()
+//! wfLZ_DetectCopyWidth()
+/*!
+32 if the CPU has AVX2 and the OS saves the ymm registers across context switches (OSXSAVE + xgetbv), 16 with SSE2, otherwise WFLZ_WILDCOPY_SIZE
+*/
 
-uint8_t* wfLZ_ChunkDecompressLoop( uint8_t* in, uint32_t** chunkDesc )
+static uint32_t wfLZ_DetectCopyWidth()
 {
-	wfLZ_HeaderChunked* header = ( wfLZ_HeaderChunked* )in;
-	wfLZ_ChunkDesc* chunks = ( wfLZ_ChunkDesc* )( in + sizeof( wfLZ_HeaderChunked ) );
-	if( *chunkDesc == NULL )
-	{
-		*chunkDesc = ( uint32_t* )chunks;
-	}
-	else
+	uint32_t regs[ 4 ]; // eax, ebx, ecx, edx
+	uint32_t width = WFLZ_WILDCOPY_SIZE;
+	uint32_t maxLeaf;
+
+	wfLZ_Cpuid( regs, 0 );
+	maxLeaf = regs[ 0 ];
+	wfLZ_Cpuid( regs, 1 );
+	if( ( regs[ 3 ] & ( 1U << 26 ) ) != 0 ) width = 16;
+	if( maxLeaf >= 7 && ( regs[ 2 ] & ( 3U << 27 ) ) == ( 3U << 27 ) )
 	{
-		++*chunkDesc;
-		if( *chunkDesc == ( uint32_t* )chunks + header->numChunks ) { return NULL; }
+		uint32_t xcr0;
+		#if defined( _MSC_VER ) && !defined( __clang__ )
+			xcr0 = ( uint32_t )_xgetbv( 0 );
+		#else
+			uint32_t xcr0High;
+			__asm__( "xgetbv" : "=a"( xcr0 ), "=d"( xcr0High ) : "c"( 0 ) );
+		#endif
+		wfLZ_Cpuid( regs, 7 );
+		if( ( xcr0 & 6 ) == 6 && ( regs[ 1 ] & ( 1U << 5 ) ) != 0 ) width = 32;
 	}
-	return in + **chunkDesc;
+	return width;
 }
 
-/*!
-Utility functions below, not exposed publicly
+//! wfLZ_Cpuid()
 
-Thanks Daniel A. Newby (Corwinoid) for optimizing these!
+static void wfLZ_Cpuid( uint32_t* const regs, const uint32_t leaf )
+{
+	#if defined( _MSC_VER ) && !defined( __clang__ )
+		__cpuidex( ( int* )regs, ( int )leaf, 0 );
+	#else
+		__cpuid_count( leaf, 0, regs[ 0 ], regs[ 1 ], regs[ 2 ], regs[ 3 ] );
+	#endif
+}
+
+#endif
+
+//! wfLZ_ChainInsert()
+/*!
+Makes pos the most recent position for its hash and links it to the one it replaces
+Returns that previous position, or NULL if there wasn't one since mf->start (or it's too far back to link to)
+Links are kept by base + position, so they stay put when the history moves along with mf->start
+Reads 4 bytes at pos, the links are F::ChainLink wide
 */
 
-//! wfLZ_MemCmp()
+template< class F > static inline const uint8_t* wfLZ_ChainInsert( const uint8_t* const pos, wfLZ_MatchFinder* const mf )
+{
+	const uint32_t offset = ( uint32_t )( pos - mf->start );
+	wfLZ_DictEntry* const entry = &mf->dict[ WFLZ_HASHPTR( pos, mf->hashShift ) ];
+	uint32_t delta = mf->base + offset - entry->pos;
+	entry->pos = mf->base + offset;
+	if( delta > mf->maxDist || delta > offset ) delta = 0;
+	( ( typename F::ChainLink* )mf->chain )[ ( mf->base + offset ) & mf->windowMask ] = ( typename F::ChainLink )delta;
+	return delta != 0 ? pos - delta : NULL;
+}
+
+//! wfLZ_ChainNext()
 /*!
-Deceptively named: the return value of this is *not* like strcmp/memcmp() -- it's just the number of sequential matching bytes, not some kind of diff
+Returns the previous position with the same hash as pos, or NULL at the end of the chain
+Only valid while pos is within maxDist of the most recently inserted position, older links have been overwritten
 */
 
-#if 0
-uint32_t wfLZ_MemCmp( const uint8_t* a, const uint8_t* b, const uint32_t maxLen )
+template< class F > static inline const uint8_t* wfLZ_ChainNext( const uint8_t* const pos, const wfLZ_MatchFinder* const mf )
 {
-	uint32_t matched = 0;
-	while( *a++ == *b++ && matched < maxLen ) ++matched;
-	return matched;
+	const uint32_t delta = ( ( const typename F::ChainLink* )mf->chain )[ ( mf->base + ( uint32_t )( pos - mf->start ) ) & mf->windowMask ];
+	return delta != 0 ? pos - delta : NULL;
 }
-#else // this depends on unaligned access, but it is only called during Compress() which has other issues on CPUs that care
-uint32_t wfLZ_MemCmp_i( const uint32_t* a, const uint32_t* b, const uint32_t count, const uint32_t maxLen )
+
+//! wfLZ_ChainFindMatch()
+/*!
+Inserts pos and returns the length of the longest match (0 if shorter than F::minMatchLen) among the earlier positions with the same hash,
+looking at up to searchDepth of them, nearest first. Its distance goes to matchDist, on ties the nearest one wins.
+The first match of at least niceLen ends the search, searchDepth and niceLen are what bound the time a position can take.
+*/
+
+template< class F > static inline uint32_t wfLZ_ChainFindMatch( const uint8_t* const pos, const uint32_t maxLen, wfLZ_MatchFinder* const mf, uint32_t* const matchDist )
 {
-	if( count >= maxLen ) return maxLen;
-	if( *a != *b )
+	const uint8_t* const windowStart = ( uint32_t )( pos - mf->start ) > mf->maxDist ? pos - mf->maxDist : mf->start;
+	const uint8_t* window = wfLZ_ChainInsert< F >( pos, mf );
+	const uint32_t niceLen = maxLen < mf->niceLen ? maxLen : mf->niceLen;
+	uint32_t bestLen = F::minMatchLen - 1;
+	uint32_t depth = mf->searchDepth;
+
+	WFLZ_STAT_ADD( mf, hashLookups, 1 );
+	WFLZ_STAT_ADD( mf, hashHits, window != NULL && window >= windowStart );
+
+	for( ; window != NULL && window >= windowStart && depth != 0; window = wfLZ_ChainNext< F >( window, mf ), --depth )
 	{
-		uint32_t n = 0;
-		uint8_t *i = (uint8_t*)a, *j = (uint8_t*)b;
-		while( *i++ == *j++ && count + n < maxLen ) ++n;
-		return count + n;
+		WFLZ_STAT_ADD( mf, candidates, 1 );
+		WFLZ_STAT_ADD( mf, hashCollisions, *( const uint32_t* )pos != *( const uint32_t* )window );
+
+		// only worth comparing if it can beat the best so far
+		if( window[ bestLen ] == pos[ bestLen ] )
+		{
+			const uint32_t len = wfLZ_MemCmp( window, pos, maxLen );
+			if( len > bestLen )
+			{
+				bestLen = len;
+				*matchDist = ( uint32_t )( pos - window );
+				if( len >= niceLen ) break;
+			}
+		}
 	}
-	return wfLZ_MemCmp_i( ++a, ++b, count + 4, maxLen );
+
+	return bestLen >= F::minMatchLen ? bestLen : 0;
 }
- 
-uint32_t wfLZ_MemCmp( const uint8_t* a, const uint8_t* b, const uint32_t maxLen )
+
+//! wfLZ_EncoderInit()
+
+template< class F > static inline void wfLZ_EncoderInit( wfLZ_Encoder* const enc, uint8_t* const out, const uint32_t inSize )
 {
-	return wfLZ_MemCmp_i( (uint32_t*)a, (uint32_t*)b, 0, maxLen );
+	enc->header.sig[0] = 'W';
+	enc->header.sig[1] = 'F';
+	enc->header.sig[2] = 'L';
+	enc->header.sig[3] = F::sig;
+	enc->header.compressedSize = 0;
+	enc->header.decompressedSize = inSize;
+	enc->header.firstBlock.dist = enc->header.firstBlock.length = enc->header.firstBlock.numLiterals = 0;
+	enc->block = ( uint8_t* )&enc->header.firstBlock;
+	enc->dst = out + sizeof( wfLZ_Header );
+	enc->numLiterals = 0;
 }
-#endif
 
-//! wfLZ_MemCpy()
+//! wfLZ_EncodeLiterals()
 
-void wfLZ_MemCpy( uint8_t* dst, const uint8_t* src, const uint32_t size )
+template< class F > static inline void wfLZ_EncodeLiterals( wfLZ_Encoder* const enc, const uint8_t* src, const uint32_t count )
 {
-#if 0
-	uint32_t i;
-	for( i = 0; i != size; ++i ) *dst++ = *src++;
-#else
-	int32_t n = (size+7) / 8;
-	switch( size % 8 )
+	const uint8_t* const srcEnd = src + count;
+	uint8_t* dst = enc->dst;
+	for( ; src != srcEnd; ++src )
 	{
-		case 0: do {    *dst++ = *src++;
-		case 7:         *dst++ = *src++;
-		case 6:         *dst++ = *src++;
-		case 5:         *dst++ = *src++;
-		case 4:         *dst++ = *src++;
-		case 3:         *dst++ = *src++;
-		case 2:         *dst++ = *src++;
-		case 1:         *dst++ = *src++;
-		} while(--n > 0);
+		// if we've hit the max number of sequential literals, we need to output a compression block header
+		if( enc->numLiterals == WFLZ_MAX_SEQUENTIAL_LITERALS )
+		{
+			F::PutNumLiterals( enc->block, enc->numLiterals );
+			enc->block = dst;
+			dst += F::blockSize;
+			F::PutMatch( enc->block, 0, 0 );
+			enc->numLiterals = 0;
+			enc->header.compressedSize += F::blockSize;
+		}
+		++enc->numLiterals;
+		*dst++ = *src;
 	}
-#endif
+	enc->header.compressedSize += count;
+	enc->dst = dst;
 }
 
-//! wfLZ_MemSet()
+//! wfLZ_EncodeMatch()
 
-void wfLZ_MemSet( uint8_t* dst, const uint8_t value, const uint32_t size )
+template< class F > static inline void wfLZ_EncodeMatch( wfLZ_Encoder* const enc, const uint32_t dist, const uint32_t len )
 {
-	uint32_t i;
-	for( i = 0; i != size; ++i ) *dst++ = value;
+	F::PutNumLiterals( enc->block, enc->numLiterals );
+	enc->block = enc->dst;
+	enc->dst += F::MatchSize( dist );
+	F::PutMatch( enc->block, dist, len - F::minMatchLen + 1 );
+	enc->numLiterals = 0;
+	enc->header.compressedSize += F::MatchSize( dist );
+}
+
+//! wfLZ_EncoderFinish()
+/*!
+Appends the 'end' block and saves the header, returns the size of the compressed data
+*/
+
+template< class F > static inline uint32_t wfLZ_EncoderFinish( wfLZ_Encoder* const enc, uint8_t* const out )
+{
+	F::PutNumLiterals( enc->block, enc->numLiterals );
+	enc->block = enc->dst;
+	enc->dst += F::blockSize;
+	F::PutMatch( enc->block, 0, 0 );
+	F::PutNumLiterals( enc->block, 0 );
+	enc->header.compressedSize += F::blockSize;
+
+	enc->header.compressedSize = F::Endian::Swap32( enc->header.compressedSize );
+	enc->header.decompressedSize = F::Endian::Swap32( enc->header.decompressedSize );
+	*( ( wfLZ_Header* )out ) = enc->header;
+
+	return enc->dst - out;
+}
+
+//! wfLZ_TreeFindMatch()
+/*!
+Binary tree match finder: positions with the same hash are kept in a tree sorted by the bytes that follow them, so descending it from the
+newest position visits ever longer matches. Inserts pos and returns the length of the longest match (0 if shorter than F::minMatchLen),
+its distance goes to matchDist. Every position must be inserted once, in order.
+The dictionary and tree hold base + position, the tree has two children per position in the window
+The tree is only sorted as far as lenLimit, so a position closer than F::maxMatchLen to the end of the input is searched without inserting
+it -- a stream frame's history goes on into the next frame, where it gets compared further than that.
+Like Compress() the search ends at the first match of niceLen, that one is then measured the rest of the way to lenLimit. Nodes that far
+apart are treated as equal, which keeps the tree sorted as far as niceLen.
+*/
+
+template< class F > static inline uint32_t wfLZ_TreeFindMatch( const uint8_t* const cur, const uint32_t lenLimit, wfLZ_MatchFinder* const mf, uint32_t* const matchDist )
+{
+	const uint32_t pos = ( uint32_t )( cur - mf->start );
+	const uint32_t node = mf->base + pos;
+	const uint32_t cyclicPos = node & mf->windowMask;
+	const uint32_t insert = lenLimit == F::maxMatchLen;
+	const uint32_t cmpLimit = lenLimit < mf->niceLen ? lenLimit : mf->niceLen;
+	uint32_t* const tree = mf->tree;
+	uint32_t scratch[2];
+	uint32_t* ptr0 = insert ? tree + cyclicPos*2 + 1 : &scratch[1];
+	uint32_t* ptr1 = insert ? tree + cyclicPos*2 : &scratch[0];
+	uint32_t len0 = 0, len1 = 0;
+	uint32_t maxLen = F::minMatchLen - 1;
+	uint32_t depth = mf->searchDepth;
+	wfLZ_DictEntry* const entry = &mf->dict[ WFLZ_HASHPTR( cur, mf->hashShift ) ];
+	uint32_t curMatch = entry->pos;
+	if( insert ) entry->pos = node;
+
+	WFLZ_STAT_ADD( mf, hashLookups, 1 );
+	WFLZ_STAT_ADD( mf, hashHits, node - curMatch <= mf->maxDist && node - curMatch <= pos );
+
+	for( ;; )
+	{
+		const uint32_t delta = node - curMatch;
+		uint32_t* pair;
+		const uint8_t* pb;
+		uint32_t len;
+		if( depth-- == 0 || delta > mf->maxDist || delta > pos )
+		{
+			*ptr0 = *ptr1 = 0;
+			break;
+		}
+		pair = tree + ( ( cyclicPos - delta ) & mf->windowMask )*2;
+		pb = cur - delta;
+		WFLZ_STAT_ADD( mf, candidates, 1 );
+		WFLZ_STAT_ADD( mf, hashCollisions, *( const uint32_t* )cur != *( const uint32_t* )pb );
+		len = len0 < len1 ? len0 : len1;
+		if( pb[len] == cur[len] )
+		{
+			++len;
+			len += wfLZ_MemCmp( pb + len, cur + len, cmpLimit - len );
+			if( len > maxLen )
+			{
+				maxLen = len;
+				*matchDist = delta;
+				if( len == cmpLimit )
+				{
+					*ptr1 = pair[0];
+					*ptr0 = pair[1];
+					break;
+				}
+			}
+		}
+		if( pb[len] < cur[len] )
+		{
+			*ptr1 = curMatch;
+			curMatch = pair[1];
+			if( insert ) ptr1 = pair + 1;
+			len1 = len;
+		}
+		else
+		{
+			*ptr0 = curMatch;
+			curMatch = pair[0];
+			if( insert ) ptr0 = pair;
+			len0 = len;
+		}
+	}
+
+	if( maxLen == cmpLimit && cmpLimit != lenLimit )
+	{
+		maxLen += wfLZ_MemCmp( cur - *matchDist + maxLen, cur + maxLen, lenLimit - maxLen );
+	}
+	return maxLen >= F::minMatchLen ? maxLen : 0;
 }
@@ -1,131 +1,522 @@
-#pragma once
-#ifndef WF_LZ_H
-#define WF_LZ_H
-
-#define WF_RESTRICT	//Supress GCC errors
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-#ifdef _MSC_VER
-	#if _MSC_VER < 1300
-	   typedef signed   char  int8_t;
-	   typedef unsigned char  uint8_t;
-	   typedef signed   short int16_t;
-	   typedef unsigned short uint16_t;
-	   typedef signed   int   int32_t;
-	   typedef unsigned int   uint32_t;
-	#else
-	   typedef signed   __int8  int8_t;
-	   typedef unsigned __int8  uint8_t;
-	   typedef signed   __int16 int16_t;
-	   typedef unsigned __int16 uint16_t;
-	   typedef signed   __int32 int32_t;
-	   typedef unsigned __int32 uint32_t;
-	#endif
-	typedef signed   __int64 int64_t;
-	typedef unsigned __int64 uint64_t;
-#else
-	#include <stdint.h>
-#endif
-
-
-//! wfLZ_GetMaxCompressedSize()
-/*! Use this to figure out the maximum size for your compression buffer */
-extern uint32_t wfLZ_GetMaxCompressedSize( const uint32_t inSize );
-
-//! wfLZ_GetWorkMemSize()
-/*! Returns the minimum size for workMem passed to wfLZ_CompressFast and wfLZ_Compress */
-extern uint32_t wfLZ_GetWorkMemSize();
-
-//! wfLZ_CompressFast()
-/* Returns the size of the compressed data
-* CompressFast greatly speeds up compression, but potentially reduces compression ratio
-  (it takes advantage of a hash table to quickly find potential matches, although maybe not the best ones)
-* swapEndian = 0, compression and decompression are carried out on processors of the same endianness
-*/
-uint32_t wfLZ_CompressFast( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const uint32_t swapEndian );
-
-//! wfLZ_Compress()
-/*! Returns the size of the compressed data
-* Can't handle inSize == 0
-* TODO: restrict would be nice
-*/
-extern uint32_t wfLZ_Compress( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const uint32_t swapEndian );
-
-//! wfLZ_GetDecompressedSize()
-/*! Returns 0 if the data does not appear to be valid WFLZ */
-extern uint32_t wfLZ_GetDecompressedSize( const uint8_t* const in );
-
-//! wfLZ_GetCompressedSize()
-/*! Returns 0 if the data does not appear to be valid WFLZ */
-extern uint32_t wfLZ_GetCompressedSize( const uint8_t* const in );
-
-//! wfLZ_Decompress()
-/*! Use wfLZ_GetDecompressedSize to allocate an output buffer of the correct size */
-extern void wfLZ_Decompress( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out );
-
-//! wfLZ_GetHeaderSize()
-/*!
-* Returns 0 if data appears invalid
-*/
-uint32_t wfLZ_GetHeaderSize( const uint8_t* const in );
-
-//! Chunk-based Compression
-/*!
-Chunk compression is an easy way to parallelize decompression.  Input is broken into chunks that can be decompressed independently.
-Compression ratio will suffer a little bit.
-*/
-
-//! wfLZ_GetMaxChunkCompressedSize()
-extern uint32_t wfLZ_GetMaxChunkCompressedSize( const uint32_t inSize, const uint32_t blockSize );
-
-//! wfLZ_ChunkCompress()
-/*!
-* blockSize must be a multiple of WFLZ_CHUNK_PAD
-* useFastCompress = 0, use Compress() instead of CompressFast()
-* TODO: Would be nice to have parallelized compression functions for this
-*/
-extern uint32_t wfLZ_ChunkCompress( uint8_t* in, const uint32_t inSize, const uint32_t blockSize, uint8_t* out, const uint8_t* workMem, const uint32_t swapEndian, const uint32_t useFastCompress );
-
-//! wfLZ_GetNumChunks()
-/*!
-* Returns 0 if data appears invalid
-*/
-uint32_t wfLZ_GetNumChunks( const uint8_t* const in );
-
-//! wfLZ_ChunkDecompressCallback()
-/*!
-* TODO: document how the fuck to use this
-* TODO: const correctness would be nice
-*/
-void wfLZ_ChunkDecompressCallback( uint8_t* in, void( *chunkCallback )( void* ) );
-
-//! wfLZ_ChunkDecompressLoop()
-/*!
-* TODO: document how the fuck to use this
-* TODO: const correctness would be nice
-*/
-uint8_t* wfLZ_ChunkDecompressLoop( uint8_t* in, uint32_t** chunkDesc );
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif // WF_LZ_H
-
-//! Example Usage
-/*!
-
-uint8_t* workMem = ( uint8_t* )malloc( wfLZ_GetWorkMemSize() );
-uint8_t* compressed = ( uint8_t* )malloc( wfLZ_GetMaxCompressedSize( decompressedSize ) );
-uint32_t compressedSize = wfLZ_CompressFast( decompressed, decompressedSize, compressed, workMem, 0 );
-
-....
-
-uint32_t decompressedSize = wfLZ_GetDecompressedSize( compressed );
-uint8_t* decompressed = ( uint8_t* )malloc( decompressedSize );
-wfLZ_Decompress( compressed, decompressed );
-
-*/
+#pragma once
+#ifndef WF_LZ_H
+#define WF_LZ_H
+
+#define WF_RESTRICT	//Supress GCC errors
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _MSC_VER
+	#if _MSC_VER < 1300
+	   typedef signed   char  int8_t;
+	   typedef unsigned char  uint8_t;
+	   typedef signed   short int16_t;
+	   typedef unsigned short uint16_t;
+	   typedef signed   int   int32_t;
+	   typedef unsigned int   uint32_t;
+	#else
+	   typedef signed   __int8  int8_t;
+	   typedef unsigned __int8  uint8_t;
+	   typedef signed   __int16 int16_t;
+	   typedef unsigned __int16 uint16_t;
+	   typedef signed   __int32 int32_t;
+	   typedef unsigned __int32 uint32_t;
+	#endif
+	typedef signed   __int64 int64_t;
+	typedef unsigned __int64 uint64_t;
+#else
+	#include <stdint.h>
+#endif
+
+
+//! wfLZ_GetMaxCompressedSize()
+/*! Use this to figure out the maximum size for your compression buffer */
+extern uint32_t wfLZ_GetMaxCompressedSize( const uint32_t inSize );
+
+//! wfLZ_GetWorkMemSize()
+/*! Returns the minimum size for workMem passed to wfLZ_CompressFast and wfLZ_Compress
+Reusing the same workMem between calls is cheaper than a fresh one each time, it only gets cleared on first use
+Don't share one workMem between threads at the same time */
+extern uint32_t wfLZ_GetWorkMemSize();
+
+//! wfLZ_CompressFast()
+/* Returns the size of the compressed data plus sizeof( wfLZ_Header ) (16 bytes) -- this has always been so and is kept for the callers that
+  depend on it; wfLZ_GetCompressedSize( out ) is the real size, which is what wfLZ_CompressOptimal and wfLZ_CompressEx return
+* CompressFast greatly speeds up compression, but potentially reduces compression ratio
+  (it takes advantage of a hash table to quickly find potential matches, although maybe not the best ones)
+* swapEndian = 0, compression and decompression are carried out on processors of the same endianness
+  swapEndian = 1 writes for a machine of the other byte order, which reads it with wfLZ_Decompress, or this one with the ...Swapped functions below
+*/
+uint32_t wfLZ_CompressFast( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const uint32_t swapEndian );
+
+//! wfLZ_Compress()
+/*! Returns the size of the compressed data plus 16 bytes, the same as wfLZ_CompressFast
+* Searches every earlier position with the same hash (up to WFLZ_MAX_CHAIN_DEPTH of them) for the longest match
+* Can't handle inSize == 0
+* TODO: restrict would be nice
+*/
+extern uint32_t wfLZ_Compress( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const uint32_t swapEndian );
+
+//! wfLZ_GetWorkMemSizeOptimal()
+/*! Returns the minimum size for workMem passed to wfLZ_CompressOptimal */
+extern uint32_t wfLZ_GetWorkMemSizeOptimal();
+
+//! wfLZ_CompressOptimal()
+/*! Returns the size of the compressed data, exactly what wfLZ_GetCompressedSize( out ) returns (unlike wfLZ_CompressFast and wfLZ_Compress)
+* Maximum compression: finds matches with a binary tree and picks the cheapest combination of literals and matches instead of the first good one
+  (much slower than wfLZ_Compress, meant for data that is compressed once and decompressed many times)
+* Output is regular WFLZ, decompression speed is unaffected
+*/
+extern uint32_t wfLZ_CompressOptimal( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const uint32_t swapEndian );
+
+//! Compression Levels and Parameters
+/*!
+wfLZ_CompressEx() takes everything that can be tuned at runtime, so one build can trade speed for ratio per call.
+The levels are numbered, higher is slower with a better ratio, and the output of every level decompresses the same way.
+*/
+
+#define WFLZ_LEVEL_FAST              1 // same as wfLZ_CompressFast()
+#define WFLZ_LEVEL_BALANCED          3 // 2 to 7 check whether the next byte starts a longer match before taking one, most of the ratio of wfLZ_Compress() at a fraction of its time
+#define WFLZ_LEVEL_DEFAULT           6
+#define WFLZ_LEVEL_COMPRESS          8 // same as wfLZ_Compress()
+#define WFLZ_LEVEL_MAX               9 // same as wfLZ_CompressOptimal()
+
+#define WFLZ_MIN_HASH_BITS           8
+#define WFLZ_MAX_HASH_BITS           22
+
+#define WFLZ_BLOCKS_LONG             1 // WFLZ, 4 byte blocks, readable by every version of wfLZ_Decompress
+#define WFLZ_BLOCKS_SHORT            2 // WFL3, 3 byte blocks for matches of up to 34 bytes at most 2KB back, smaller output for small inputs
+#define WFLZ_BLOCKS_AUTO             3 // WFL3 for inputs of up to 12KB, WFLZ for anything bigger
+#define WFLZ_BLOCKS_FAR              4 // WFLX, 4 byte blocks and 5 for matches more than 32KB back, up to 8MB back. Never picked by WFLZ_BLOCKS_AUTO
+
+#define WFLZ_FILTER_NONE             0
+#define WFLZ_FILTER_DXT1             1 // ZLF1, 8 byte DXT1 blocks: the endpoint colours of each block go to one plane and its index word to another
+#define WFLZ_FILTER_DXT5             2 // ZLF5, 16 byte DXT5 blocks: alpha, endpoint colours and index words each get a plane
+
+//! wfLZ_CompressStats
+/*!
+What a compression call did, to see why something compresses badly or slowly. Point wfLZ_CompressParams::stats at one and wfLZ_CompressEx
+clears it and fills it in, a stream compressor adds up all of its frames. Only collected when wfLZ.cpp is built with WFLZ_STATS defined,
+otherwise nothing is counted and the compressors run exactly as fast as without it.
+* numMatches, matchBytes: the matches and how many bytes of input they cover
+* numLiterals: bytes stored as they are, including whole stored frames
+* blockOverhead: everything else in the output, headers and blocks
+* matchLenHist, matchDistHist: matches by floor( log2( length ) ) and floor( log2( distance ) ), [ 3 ] counts those from 8 to 15
+* hashLookups: positions the match finder looked up to find a match at
+* hashHits: lookups that found an earlier position with the same hash within reach
+* candidates: earlier positions looked at, one per hit at WFLZ_LEVEL_FAST, up to searchDepth on the other levels
+* hashCollisions: candidates that only shared the hash, their first 4 bytes differ -- if it's a large part of candidates, try more hashBits
+* fastBytes: input left to the WFLZ_LEVEL_FAST parser after timeLimit ran out
+*/
+#define WFLZ_STATS_HIST_SIZE         32
+typedef struct _wfLZ_CompressStats
+{
+	uint64_t numMatches;
+	uint64_t matchBytes;
+	uint64_t numLiterals;
+	uint64_t blockOverhead;
+	uint64_t matchLenHist[ WFLZ_STATS_HIST_SIZE ];
+	uint64_t matchDistHist[ WFLZ_STATS_HIST_SIZE ];
+	uint64_t hashLookups;
+	uint64_t hashHits;
+	uint64_t candidates;
+	uint64_t hashCollisions;
+	uint64_t fastBytes;
+} wfLZ_CompressStats;
+
+//! wfLZ_CompressParams
+/*!
+Anything left at 0 takes the default for the level
+* level: WFLZ_LEVEL_FAST to WFLZ_LEVEL_MAX, 0 is WFLZ_LEVEL_DEFAULT
+* hashBits: the dictionary has 1 << hashBits entries (WFLZ_MIN_HASH_BITS to WFLZ_MAX_HASH_BITS), each takes 4 bytes of workMem
+  more entries means fewer hash collisions, which helps ratio on large inputs
+* searchDepth: how many earlier positions are compared against for each byte of input (WFLZ_LEVEL_FAST only ever looks at one)
+* maxDist: how far back a match may reach, up to 0xffff, a shorter window is faster and takes less workMem
+  WFLZ_BLOCKS_FAR defaults to 0xfffff and goes up to 0x7fffff, the window takes 4 bytes of workMem a byte (8 at WFLZ_LEVEL_MAX)
+* swapEndian: same as for wfLZ_CompressFast()
+* blocks: WFLZ_BLOCKS_LONG (0 as well), WFLZ_BLOCKS_SHORT, WFLZ_BLOCKS_AUTO or WFLZ_BLOCKS_FAR, short blocks cap maxDist at 0x7ff
+  streams and dictionary compression always write long blocks, with the short window if WFLZ_BLOCKS_SHORT was asked for (WFLZ_BLOCKS_FAR is
+  WFLZ_BLOCKS_LONG for them). Far blocks only pay off on inputs with repeats further apart than 64KB (level data, archives of similar files),
+  they also default to 20 hashBits above WFLZ_LEVEL_FAST
+* niceLen: a match at least this long is taken without searching any further, so long matches in repetitive data don't get compared against
+  every candidate. Defaults to 128 for levels 2 to 6 and the longest match the blocks can hold for the others
+* timeLimit: milliseconds the call may take (0 for no limit), once they are up the rest of the input is compressed like WFLZ_LEVEL_FAST does it.
+  The check is made every 4KB of input (every segment of 16KB at WFLZ_LEVEL_MAX), so a call runs over by about as long as that takes.
+  With a limit the output depends on how fast the machine is, it still decompresses the same way. A stream gets timeLimit for each frame
+* filter: WFLZ_FILTER_NONE (0), WFLZ_FILTER_DXT1 or WFLZ_FILTER_DXT5, only wfLZ_ChunkCompressEx looks at it.
+  Texture data is split into planes before it is compressed, identical endpoints and identical index words end up next to each other and
+  match far more often than whole blocks do (30 to 40% smaller on synthetic DXT data). The chunk decompressors put the blocks back together
+* stats: counts what the call did if not NULL, see wfLZ_CompressStats
+*/
+typedef struct _wfLZ_CompressParams
+{
+	uint32_t level;
+	uint32_t hashBits;
+	uint32_t searchDepth;
+	uint32_t maxDist;
+	uint32_t swapEndian;
+	uint32_t blocks;
+	uint32_t niceLen;
+	uint32_t timeLimit;
+	uint32_t filter;
+	wfLZ_CompressStats* stats;
+} wfLZ_CompressParams;
+
+//! wfLZ_CompressParamsInit()
+/*! Sets level and the defaults for everything else, use this rather than filling in the struct so new fields get their defaults */
+extern void wfLZ_CompressParamsInit( wfLZ_CompressParams* const params, const uint32_t level );
+
+//! wfLZ_GetWorkMemSizeEx()
+/*! Returns the minimum size for workMem passed to wfLZ_CompressEx with these params */
+extern uint32_t wfLZ_GetWorkMemSizeEx( const wfLZ_CompressParams* const params );
+
+//! wfLZ_CompressEx()
+/*! Returns the size of the compressed data
+* Unlike wfLZ_Compress and wfLZ_CompressFast this is the real size, the same as wfLZ_GetCompressedSize( out ) returns
+* workMem can be reused between calls with different params as long as it is big enough for each of them
+*/
+extern uint32_t wfLZ_CompressEx( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint8_t* workMem, const wfLZ_CompressParams* const params );
+
+//! wfLZ_GetDecompressedSize()
+/*! Returns 0 if the data does not appear to be valid WFLZ */
+extern uint32_t wfLZ_GetDecompressedSize( const uint8_t* const in );
+
+//! wfLZ_GetCompressedSize()
+/*! Returns 0 if the data does not appear to be valid WFLZ */
+extern uint32_t wfLZ_GetCompressedSize( const uint8_t* const in );
+
+//! wfLZ_Decompress()
+/*! Use wfLZ_GetDecompressedSize to allocate an output buffer of the correct size */
+extern void wfLZ_Decompress( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out );
+
+//! wfLZ_DecompressSafe()
+/*! Returns WFLZ_OK or one of the WFLZ_ERROR_ codes below, never reads past in+inSize or writes past out+outSize
+* Use this instead of wfLZ_Decompress when the compressed data can't be trusted
+* Runs at nearly the speed of wfLZ_Decompress, every byte is only checked near the ends of the buffers
+*/
+extern int32_t wfLZ_DecompressSafe( const uint8_t* WF_RESTRICT const in, const uint32_t inSize, uint8_t* WF_RESTRICT const out, const uint32_t outSize );
+
+//! Swapped Data
+/*!
+Data compressed with swapEndian = 1 on a machine of the other byte order -- console builds of the same assets -- is read as it is by these,
+at the same speed as the functions they're named after, without swapping the whole buffer first. The output is the same bytes either way.
+A single WFLZ / WFLR buffer doesn't say which byte order it was written in, the caller has to know. A ZLFW stream does, see wfLZ_IsSwapped.
+*/
+
+//! wfLZ_IsSwapped()
+/*! Returns 1 if in is ZLFW written in the other byte order, 0 if it's native or not ZLFW */
+extern uint32_t wfLZ_IsSwapped( const uint8_t* const in );
+
+extern uint32_t wfLZ_GetDecompressedSizeSwapped( const uint8_t* const in );
+extern uint32_t wfLZ_GetCompressedSizeSwapped( const uint8_t* const in );
+extern void wfLZ_DecompressSwapped( const uint8_t* WF_RESTRICT const in, uint8_t* WF_RESTRICT const out );
+extern int32_t wfLZ_DecompressSafeSwapped( const uint8_t* WF_RESTRICT const in, const uint32_t inSize, uint8_t* WF_RESTRICT const out, const uint32_t outSize );
+extern void wfLZ_ChunkDecompressParallelSwapped( const uint8_t* const in, uint8_t* const out, const uint32_t numThreads );
+extern int32_t wfLZ_ChunkDecompressParallelSafeSwapped( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint32_t outSize, const uint32_t numThreads );
+
+#define WFLZ_OK                      0
+#define WFLZ_ERROR_BAD_HEADER       -1 // not WFLZ data
+#define WFLZ_ERROR_INPUT_OVERRUN    -2 // compressed data runs past inSize
+#define WFLZ_ERROR_OUTPUT_OVERRUN   -3 // decompressed data would run past outSize
+#define WFLZ_ERROR_CORRUPT          -4 // a match reaches back before the start of the output, or the data doesn't decompress to the size in its header
+
+//! wfLZ_GetCopyWidth()
+/*! How many bytes at a time wfLZ_Decompress copies on this machine: 32 with AVX2, 16 with SSE2, otherwise 8
+* x86 builds check the CPU once, the first time they decompress, so the same binary gets the widest copies each machine has
+*/
+extern uint32_t wfLZ_GetCopyWidth();
+
+//! wfLZ_GetInPlaceMargin()
+/*!
+* Returns how many bytes past the decompressed size a buffer needs for in (WFLZ, WFLR or ZLFW) to be decompressed within that same buffer:
+*   const uint32_t compressedSize = wfLZ_GetCompressedSize( in );
+*   const uint32_t bufferSize = wfLZ_GetDecompressedSize( in ) + wfLZ_GetInPlaceMargin( in );
+*   uint8_t* buffer = malloc( bufferSize );
+*   memcpy( buffer + bufferSize - compressedSize, in, compressedSize ); // or load it straight from the file
+*   wfLZ_DecompressInPlace( buffer + bufferSize - compressedSize, buffer );
+* The peak memory use is bufferSize instead of compressed + decompressed size, the margin is usually a few dozen bytes to a few percent of the
+* compressed size. It depends on the data, so it has to be measured on the compressed data once and stored next to it if the compressed data
+* is going to be loaded straight into the buffer.
+*/
+extern uint32_t wfLZ_GetInPlaceMargin( const uint8_t* const in );
+
+//! wfLZ_DecompressInPlace()
+/*! Decompresses in, which sits at the end of out's buffer as shown above, to out. Also takes ZLFW (and ZLF1 / ZLF5), its chunks are decompressed one after another */
+extern void wfLZ_DecompressInPlace( const uint8_t* const in, uint8_t* const out );
+
+//! wfLZ_GetHeaderSize()
+/*!
+* Returns 0 if data appears invalid
+*/
+uint32_t wfLZ_GetHeaderSize( const uint8_t* const in );
+
+//! Chunk-based Compression
+/*!
+Chunk compression is an easy way to parallelize decompression.  Input is broken into chunks that can be decompressed independently.
+Compression ratio will suffer a little bit.
+Chunks that don't compress are stored as they are (signature WFLR instead of WFLZ), wfLZ_Decompress and wfLZ_DecompressSafe just copy them.
+*/
+
+//! wfLZ_GetMaxChunkCompressedSize()
+extern uint32_t wfLZ_GetMaxChunkCompressedSize( const uint32_t inSize, const uint32_t blockSize );
+
+//! wfLZ_ChunkCompress()
+/*!
+* blockSize must be a multiple of WFLZ_CHUNK_PAD
+* useFastCompress = 0, use Compress() instead of CompressFast()
+* a sample of each chunk is checked first, chunks that look like random data (DXT indices, already compressed data) are stored without trying
+* see wfLZ_ChunkCompressParallel to compress the chunks on several threads
+*/
+extern uint32_t wfLZ_ChunkCompress( uint8_t* in, const uint32_t inSize, const uint32_t blockSize, uint8_t* out, const uint8_t* workMem, const uint32_t swapEndian, const uint32_t useFastCompress );
+
+//! wfLZ_GetWorkMemSizeParallel()
+/*! Returns the minimum size for workMem passed to wfLZ_ChunkCompressParallel with numThreads, one wfLZ_GetWorkMemSize() per thread */
+extern uint32_t wfLZ_GetWorkMemSizeParallel( const uint32_t numThreads );
+
+//! wfLZ_ChunkCompressParallel()
+/*!
+* Same as wfLZ_ChunkCompress, down to the last byte, but numThreads chunks are compressed at once (0 is one thread per core)
+* out must be wfLZ_GetMaxChunkCompressedSize( inSize, blockSize ) bytes, it is used as scratch space until the chunks are moved into place
+* workMem must be wfLZ_GetWorkMemSizeParallel( numThreads ) bytes
+*/
+extern uint32_t wfLZ_ChunkCompressParallel( const uint8_t* const in, const uint32_t inSize, const uint32_t blockSize, uint8_t* const out, const uint8_t* workMem, const uint32_t numThreads, const uint32_t swapEndian, const uint32_t useFastCompress );
+
+//! wfLZ_GetWorkMemSizeChunkEx()
+/*!
+Returns the minimum size for workMem passed to wfLZ_ChunkCompressEx with params, blockSize and numThreads, one wfLZ_GetWorkMemSizeEx( params )
+per thread, plus blockSize per thread for the filtered chunk if params->filter is set
+*/
+extern uint32_t wfLZ_GetWorkMemSizeChunkEx( const wfLZ_CompressParams* const params, const uint32_t blockSize, const uint32_t numThreads );
+
+//! wfLZ_ChunkCompressEx()
+/*!
+* wfLZ_ChunkCompressParallel with every chunk compressed with params, like wfLZ_CompressEx does it (params->swapEndian also swaps the chunk table)
+* with WFLZ_BLOCKS_FAR chunks of more than 64KB get matches from further back, the chunks are still decompressed on their own
+* with a params->filter the signature is ZLF1 or ZLF5 instead of ZLFW, which older versions of wfLZ turn down as not being WFLZ at all,
+  blockSize should then be a multiple of the texture's block size so no block is split between two chunks
+* workMem must be wfLZ_GetWorkMemSizeChunkEx( params, blockSize, numThreads ) bytes
+*/
+extern uint32_t wfLZ_ChunkCompressEx( const uint8_t* const in, const uint32_t inSize, const uint32_t blockSize, uint8_t* const out, const uint8_t* workMem, const uint32_t numThreads, const wfLZ_CompressParams* const params );
+
+//! wfLZ_GetNumChunks()
+/*!
+* Returns 0 if data appears invalid
+*/
+uint32_t wfLZ_GetNumChunks( const uint8_t* const in );
+
+//! wfLZ_GetFilter()
+/*! Returns the WFLZ_FILTER_ the chunks of in were compressed with, WFLZ_FILTER_NONE if it isn't ZLF1 or ZLF5 */
+extern uint32_t wfLZ_GetFilter( const uint8_t* const in );
+
+//! wfLZ_Unfilter()
+/*!
+* Undoes filter on one decompressed chunk, in place
+* The chunk decompressors below already do this, it's for the chunks of wfLZ_ChunkDecompressCallback and wfLZ_ChunkDecompressLoop
+*/
+extern void wfLZ_Unfilter( uint8_t* const data, const uint32_t size, const uint32_t filter );
+
+//! wfLZ_ChunkDecompressCallback()
+/*!
+* TODO: document how the fuck to use this
+* TODO: const correctness would be nice
+* chunks of ZLF1 / ZLF5 need wfLZ_Unfilter( chunk, size, wfLZ_GetFilter( in ) ) once they're decompressed
+*/
+void wfLZ_ChunkDecompressCallback( uint8_t* in, void( *chunkCallback )( void* ) );
+
+//! wfLZ_ChunkDecompressLoop()
+/*!
+* TODO: document how the fuck to use this
+* TODO: const correctness would be nice
+* same for ZLF1 / ZLF5 as wfLZ_ChunkDecompressCallback
+*/
+uint8_t* wfLZ_ChunkDecompressLoop( uint8_t* in, uint32_t** chunkDesc );
+
+//! wfLZ_ChunkDecompressParallel()
+/*!
+* Decompresses all the chunks of in to out, numThreads chunks at once (0 is one thread per core)
+* Every chunk's place in out is found up front from the chunk headers, chunks made by wfLZ_ChunkCompress are all blockSize bytes but the last
+* one, so chunk n lands at n*blockSize. Chunks of differing sizes from anywhere else are decompressed one after another on the calling thread.
+* A ZLF1 / ZLF5 chunk is put back together by the thread that decompressed it, right after it's done and still in cache
+*/
+extern void wfLZ_ChunkDecompressParallel( const uint8_t* const in, uint8_t* const out, const uint32_t numThreads );
+
+//! wfLZ_ChunkDecompressParallelSafe()
+/*! Same, but checked like wfLZ_DecompressSafe: returns WFLZ_OK or one of the WFLZ_ERROR_ codes, never reads past in+inSize or writes past out+outSize */
+extern int32_t wfLZ_ChunkDecompressParallelSafe( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, const uint32_t outSize, const uint32_t numThreads );
+
+//! wfLZ_GetChunkIndexSize()
+/*! Returns the size of the index wfLZ_ChunkBuildIndex writes for in, one uint32_t per chunk plus one */
+extern uint32_t wfLZ_GetChunkIndexSize( const uint8_t* const in );
+
+//! wfLZ_ChunkBuildIndex()
+/*!
+* index[ n ] is where chunk n starts in the decompressed data, the last entry is the total decompressed size
+* Build it once per stream, then any byte's chunk is a binary search away instead of a walk over every chunk header before it
+*/
+extern void wfLZ_ChunkBuildIndex( const uint8_t* const in, uint32_t* const index );
+
+//! wfLZ_GetChunkRangeScratchSize()
+/*! Returns the size of the scratch buffer wfLZ_ChunkDecompressRange needs for in, the largest chunk's decompressed size */
+extern uint32_t wfLZ_GetChunkRangeScratchSize( const uint8_t* const in );
+
+//! wfLZ_ChunkDecompressRange()
+/*!
+* Decompresses bytes start to start+len of the decompressed data to out, only the chunks overlapping that range are decompressed
+* index comes from wfLZ_ChunkBuildIndex, scratch is only used for chunks the range starts or ends partway through (it can be NULL if the range lines up with chunks)
+* Returns the number of bytes written, less than len if the range runs past the end of the data, 0 for len == 0
+* Native byte order and unchecked like wfLZ_Decompress, only for data you trust (there is no Safe or Swapped version)
+*/
+extern uint32_t wfLZ_ChunkDecompressRange( const uint8_t* const in, const uint32_t* const index, const uint32_t start, const uint32_t len, uint8_t* const out, uint8_t* const scratch );
+
+//! Streaming Compression
+/*!
+A stream compressor takes its input a piece at a time and writes the compressed stream into an out buffer of any size, so neither the whole input
+nor the whole output has to be in memory at once. The memory it needs is fixed by its params and blockSize.
+Input is collected into blocks of blockSize bytes, each one is compressed into a frame: a regular header and compressed data, whose matches can reach
+back maxDist bytes (0xffff by default) into the frames before it. Frames with matches into earlier frames (signature WFLS) need the output of the frames
+before them right in front of their own, wfLZ_Decompress them one after the other into one buffer or use a stream decompressor (below).
+The first frame is plain WFLZ, frames that didn't compress are WFLR.
+*/
+
+typedef struct _wfLZ_StreamCompressor wfLZ_StreamCompressor;
+
+//! wfLZ_GetStreamCompressorSize()
+/*! Returns the size of the memory for wfLZ_StreamCompressorInit, blockSize = 0 picks the default (256KB) */
+extern uint32_t wfLZ_GetStreamCompressorSize( const wfLZ_CompressParams* const params, const uint32_t blockSize );
+
+//! wfLZ_StreamCompressorInit()
+/*!
+* mem must be at least wfLZ_GetStreamCompressorSize( params, blockSize ) bytes and stays in use until the stream is done, the stream compressor lives in it
+* blockSize = 0 picks the default, bigger blocks compress a little better, each one is decompressed in one go
+*/
+extern wfLZ_StreamCompressor* wfLZ_StreamCompressorInit( uint8_t* const mem, const wfLZ_CompressParams* const params, const uint32_t blockSize );
+
+//! wfLZ_StreamCompress()
+/*!
+Returns the number of bytes written to out, inUsed gets the number of bytes taken from in
+* in that isn't used (because out is full) has to be passed again next time
+* flush != 0 compresses whatever input is waiting even if it doesn't fill a block, keep calling it with more room in out until it writes nothing,
+  then everything passed in so far is in the output -- do that at the end of the stream
+* the stream can carry on after a flush, matches still reach back across it
+*/
+extern uint32_t wfLZ_StreamCompress( wfLZ_StreamCompressor* const stream, const uint8_t* const in, const uint32_t inSize, uint32_t* const inUsed, uint8_t* const out, const uint32_t outSize, const uint32_t flush );
+
+//! wfLZ_StreamCompressorLoadDict()
+/*!
+* Call right after wfLZ_StreamCompressorInit, the stream is compressed as if the last maxDist bytes of dict came right before it, so matches can reach
+  into them. Decompress it with the same dictionary loaded, see wfLZ_StreamDecompressorLoadDict
+*/
+extern void wfLZ_StreamCompressorLoadDict( wfLZ_StreamCompressor* const stream, const uint8_t* const dict, const uint32_t dictSize );
+
+//! Preset Dictionaries
+/*!
+Small buffers compress poorly on their own, there's nothing for their first bytes to match. Compressing them with a dictionary -- data that looks
+like them, common DXT blocks, a palette, an earlier frame -- lets matches reach back into the last 64KB of the dictionary as if it came right
+before the input. The same dictionary has to be given to the decompressor.
+Dictionary compressed buffers are WFLS (WFLR if they didn't compress), wfLZ_Decompress can't decompress them, use wfLZ_DecompressDict.
+*/
+
+//! wfLZ_GetCompressDictMemSize()
+/*! Returns the size of mem for wfLZ_CompressDict, it depends on inSize: wfLZ_GetWorkMemSizeEx + the history (params->maxDist, 64KB at most, since
+  dictionary compression writes long blocks even for WFLZ_BLOCKS_FAR) + inSize + wfLZ_GetMaxCompressedSize( inSize ), a little over 2x inSize + 64KB */
+extern uint32_t wfLZ_GetCompressDictMemSize( const wfLZ_CompressParams* const params, const uint32_t inSize );
+
+//! wfLZ_CompressDict()
+/*!
+* Compresses in with dict before it, out must be wfLZ_GetMaxCompressedSize( inSize ) bytes
+* The dictionary is hashed for every call, about what compressing the last 64KB of it costs
+*/
+extern uint32_t wfLZ_CompressDict( const uint8_t* const in, const uint32_t inSize, uint8_t* const out, uint8_t* const mem, const wfLZ_CompressParams* const params, const uint8_t* const dict, const uint32_t dictSize );
+
+//! wfLZ_DecompressDict()
+/*! Decompresses the output of wfLZ_CompressDict, or any WFLZ / WFL3 / WFLX / WFLR buffer. It runs at the speed of wfLZ_Decompress, apart from matches into dict
+* Unchecked like wfLZ_Decompress: dict must be byte for byte the one given to wfLZ_CompressDict. A match reaching back past the start of dict stops
+  decompression, the rest of out is left as it is
+*/
+extern void wfLZ_DecompressDict( const uint8_t* const in, uint8_t* const out, const uint8_t* const dict, const uint32_t dictSize );
+
+//! Streaming Decompression
+/*!
+A stream decompressor takes compressed data a piece at a time and decompresses it into a ring buffer supplied by the caller, so a stream of any size
+decompresses in fixed memory. It reads frames one after the other (WFLZ, WFLR and WFLS, whatever wfLZ_StreamCompress writes, or a single regular
+WFLZ buffer, not WFL3) and checks everything like wfLZ_DecompressSafe does.
+The caller takes the output out of the ring with wfLZ_StreamDecompressGetOutput / wfLZ_StreamDecompressConsume. When the ring is full of output
+that hasn't been consumed, wfLZ_StreamDecompress stops and returns WFLZ_STREAM_RING_FULL.
+
+const uint8_t* data;
+uint32_t used, size;
+for( each piece of input )
+{
+	while( piece not used up )
+	{
+		result = wfLZ_StreamDecompress( stream, piece, pieceSize, &used );
+		if( result < 0 ) error
+		piece += used; pieceSize -= used;
+		while( ( size = wfLZ_StreamDecompressGetOutput( stream, &data ) ) != 0 ) { use size bytes at data; wfLZ_StreamDecompressConsume( stream, size ); }
+	}
+}
+wfLZ_StreamDecompressEnd( stream ) == WFLZ_OK if the input ended between frames
+*/
+
+#define WFLZ_STREAM_MIN_RING_SIZE    0x10000 // matches reach back up to 0xffff bytes
+#define WFLZ_STREAM_RING_FULL        1       // not an error, consume some output and call again with the rest of the input
+
+typedef struct _wfLZ_StreamDecompressor wfLZ_StreamDecompressor;
+
+//! wfLZ_GetStreamDecompressorSize()
+/*! Returns the size of the memory for wfLZ_StreamDecompressorInit, not including the ring */
+extern uint32_t wfLZ_GetStreamDecompressorSize();
+
+//! wfLZ_StreamDecompressorInit()
+/*!
+* mem must be at least wfLZ_GetStreamDecompressorSize() bytes, the stream decompressor lives in it
+* ringSize must be at least WFLZ_STREAM_MIN_RING_SIZE (returns NULL otherwise), at exactly that size every byte is copied on its own -- a little
+  bigger (128KB say) lets most of the output be copied many bytes at a time, the same as wfLZ_Decompress
+*/
+extern wfLZ_StreamDecompressor* wfLZ_StreamDecompressorInit( uint8_t* const mem, uint8_t* const ring, const uint32_t ringSize );
+
+//! wfLZ_StreamDecompressorLoadDict()
+/*! Same as wfLZ_StreamCompressorLoadDict, the stream is decompressed as if the end of dict came right before it. Call it right after wfLZ_StreamDecompressorInit */
+extern void wfLZ_StreamDecompressorLoadDict( wfLZ_StreamDecompressor* const stream, const uint8_t* const dict, const uint32_t dictSize );
+
+//! wfLZ_StreamDecompress()
+/*!
+Returns WFLZ_OK once all of in has been used, WFLZ_STREAM_RING_FULL if it stopped because the ring is full, or one of the WFLZ_ERROR_ codes
+inUsed gets the number of bytes taken from in, in can end anywhere, even in the middle of a header
+*/
+extern int32_t wfLZ_StreamDecompress( wfLZ_StreamDecompressor* const stream, const uint8_t* const in, const uint32_t inSize, uint32_t* const inUsed );
+
+//! wfLZ_StreamDecompressGetOutput()
+/*! Returns how many bytes of output at *data haven't been consumed yet, output that wraps around the end of the ring takes two calls */
+extern uint32_t wfLZ_StreamDecompressGetOutput( const wfLZ_StreamDecompressor* const stream, const uint8_t** const data );
+
+//! wfLZ_StreamDecompressConsume()
+/*! Frees size bytes of the output for the decompressor to write over */
+extern void wfLZ_StreamDecompressConsume( wfLZ_StreamDecompressor* const stream, const uint32_t size );
+
+//! wfLZ_StreamDecompressEnd()
+/*! Returns WFLZ_OK if the input so far ends between frames, WFLZ_ERROR_INPUT_OVERRUN if a frame was cut off, or the error that stopped the stream */
+extern int32_t wfLZ_StreamDecompressEnd( const wfLZ_StreamDecompressor* const stream );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WF_LZ_H
+
+//! Example Usage
+/*!
+
+uint8_t* workMem = ( uint8_t* )malloc( wfLZ_GetWorkMemSize() );
+uint8_t* compressed = ( uint8_t* )malloc( wfLZ_GetMaxCompressedSize( decompressedSize ) );
+uint32_t compressedSize = wfLZ_CompressFast( decompressed, decompressedSize, compressed, workMem, 0 );
+
+....
+
+uint32_t decompressedSize = wfLZ_GetDecompressedSize( compressed );
+uint8_t* decompressed = ( uint8_t* )malloc( decompressedSize );
+wfLZ_Decompress( compressed, decompressed );
+
+*/
@@ -0,0 +1,555 @@
+#include "wfLZ.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <dirent.h>
+#include <sys/stat.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BENCH_RDTSC
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define BENCH_RDTSC
+#endif
+using namespace std;
+
+//------------------------------
+// Throughput and ratio of each way of compressing (CompressFast, Compress, ChunkCompress at a few block sizes, or any level),
+// over a corpus of files plus built-in synthetic data, to measure changes to the compressors' and decompressor's hot paths
+// (build with different -DWFLZ_MATCH_LEN_SIZE=n to compare the match length kernels)
+//------------------------------
+
+typedef struct
+{
+    string name;
+    vector<uint8_t> data;
+} Sample;
+
+// how a sample gets compressed, and so how it's decompressed again
+typedef struct
+{
+    string name;
+    uint32_t level;     // wfLZ_CompressEx() at this level if not 0
+    uint32_t blockSize; // wfLZ_ChunkCompress() into chunks of this size if not 0
+    uint32_t fast;      // wfLZ_CompressFast() instead of wfLZ_Compress()
+    uint32_t blocks;    // wfLZ_CompressParams::blocks for the level codecs
+    uint32_t niceLen;   // wfLZ_CompressParams::niceLen and timeLimit for the level codecs, 0 is the default
+    uint32_t timeLimit;
+    uint32_t filter;    // wfLZ_CompressParams::filter for the chunk codecs
+} Codec;
+
+// one timed run
+typedef struct
+{
+    double seconds;
+    uint64_t cycles;
+} Timing;
+
+static const uint32_t SYNTHETIC_SIZE = 0x400000;
+
+static bool loadFile(const char* filename, vector<uint8_t>& data)
+{
+    FILE* f = fopen(filename, "rb");
+    if(f == NULL)
+        return false;
+    fseek(f, 0, SEEK_END);
+    data.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    size_t read = data.empty() ? 0 : fread(&data[0], 1, data.size(), f);
+    fclose(f);
+    return read == data.size();
+}
+
+//Every non-empty regular file in dir, in name order so runs line up
+static bool loadDir(const string& dir, vector<Sample>& samples)
+{
+    DIR* d = opendir(dir.c_str());
+    if(d == NULL)
+        return false;
+    vector<string> names;
+    for(struct dirent* entry = readdir(d); entry != NULL; entry = readdir(d))
+    {
+        string path = dir + "/" + entry->d_name;
+        struct stat st;
+        if(stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && st.st_size != 0)
+            names.push_back(entry->d_name);
+    }
+    closedir(d);
+    sort(names.begin(), names.end());
+
+    for(size_t i = 0; i < names.size(); i++)
+    {
+        Sample sample;
+        sample.name = names[i];
+        if(!loadFile((dir + "/" + names[i]).c_str(), sample.data))
+            return false;
+        samples.push_back(sample);
+    }
+    return true;
+}
+
+static uint32_t nextRandom(uint32_t& seed)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+//Text-like data: words from a small vocabulary, so there are plenty of matches of every length and distance
+static void makeText(vector<uint8_t>& data, uint32_t size)
+{
+    static const char* words[] = { "the ", "wfLZ ", "block ", "match ", "literal ", "header ", "chunk ", "compress ", "window ", "distance ",
+                                   "length ", "of ", "and ", "a ", "to ", "texture ", "frame ", "sprite ", "\n", "0x1000 " };
+    uint32_t seed = 1;
+    while(data.size() < size)
+    {
+        const char* w = words[nextRandom(seed) % (sizeof(words) / sizeof(words[0]))];
+        data.insert(data.end(), w, w + strlen(w));
+    }
+    data.resize(size);
+}
+
+//DXT1-like data: 8 byte blocks of two 565 colors that drift slowly across the image and 4 bytes of 2-bit indices
+//a quarter of the blocks are flat (all index 0), like the empty areas around sprites, half reuse a few common index patterns and the rest are noise
+static void makeDxt(vector<uint8_t>& data, uint32_t size)
+{
+    uint32_t seed = 2;
+    uint32_t patterns[16];
+    for(uint32_t i = 0; i < 16; i++)
+        patterns[i] = nextRandom(seed) << 16 | nextRandom(seed);
+    data.assign(size, 0);
+    for(uint32_t i = 0; i + 8 <= size; i += 8)
+    {
+        const uint32_t block = i / 8;
+        const uint16_t c0 = (uint16_t)(((block / 1024) & 0x1f) << 11 | ((block / 64) & 0x3f) << 5 | ((block / 4) & 0x1f));
+        const uint16_t c1 = (uint16_t)(c0 + 0x0841);
+        const uint32_t kind = nextRandom(seed) & 3;
+        const uint32_t indices = kind == 0 ? 0 : kind == 3 ? nextRandom(seed) << 16 | nextRandom(seed) : patterns[nextRandom(seed) & 15];
+        data[i + 0] = (uint8_t)c0;
+        data[i + 1] = (uint8_t)(c0 >> 8);
+        data[i + 2] = (uint8_t)c1;
+        data[i + 3] = (uint8_t)(c1 >> 8);
+        memcpy(&data[i + 4], &indices, 4);
+    }
+}
+
+//Incompressible data, for the stored path and the skipping in CompressFast()
+static void makeRandom(vector<uint8_t>& data, uint32_t size)
+{
+    uint32_t seed = 3;
+    data.resize(size);
+    for(uint32_t i = 0; i < size; i++)
+        data[i] = (uint8_t)nextRandom(seed);
+}
+
+//Long runs of zeros with short bursts of noise between them, the longest matches there are
+static void makeZeroRuns(vector<uint8_t>& data, uint32_t size)
+{
+    uint32_t seed = 4;
+    data.assign(size, 0);
+    for(uint32_t i = nextRandom(seed) % 4096; i < size; i += nextRandom(seed) % 4096)
+    {
+        const uint32_t burst = 1 + nextRandom(seed) % 64;
+        for(uint32_t j = 0; j < burst && i < size; j++, i++)
+            data[i] = (uint8_t)nextRandom(seed);
+    }
+}
+
+static void addSynthetic(vector<Sample>& samples)
+{
+    static const char* names[] = { "synthetic dxt", "synthetic text", "synthetic random", "synthetic zero runs" };
+    static void (* const makers[])(vector<uint8_t>&, uint32_t) = { makeDxt, makeText, makeRandom, makeZeroRuns };
+    for(size_t i = 0; i < sizeof(makers) / sizeof(makers[0]); i++)
+    {
+        Sample sample;
+        sample.name = names[i];
+        makers[i](sample.data, SYNTHETIC_SIZE);
+        samples.push_back(sample);
+    }
+}
+
+//fast, compress, chunk<KB>, level<n>, or levels for every level
+static bool parseCodec(const string& name, vector<Codec>& codecs)
+{
+    Codec codec;
+    codec.name = name;
+    codec.level = codec.blockSize = codec.fast = codec.blocks = codec.niceLen = codec.timeLimit = codec.filter = 0;
+    if(name == "levels")
+    {
+        for(uint32_t level = 1; level <= WFLZ_LEVEL_MAX; level++)
+        {
+            ostringstream levelName;
+            levelName << "level" << level;
+            parseCodec(levelName.str(), codecs);
+        }
+        return true;
+    }
+    else if(name == "fast")
+        codec.fast = 1;
+    else if(name.compare(0, 5, "chunk") == 0)
+    {
+        codec.blockSize = atoi(name.c_str() + 5) * 1024;
+        if(codec.blockSize == 0)
+            return false;
+    }
+    else if(name.compare(0, 5, "level") == 0)
+    {
+        codec.level = atoi(name.c_str() + 5);
+        if(codec.level == 0 || codec.level > WFLZ_LEVEL_MAX)
+            return false;
+    }
+    else if(name != "compress")
+        return false;
+    codecs.push_back(codec);
+    return true;
+}
+
+static uint32_t getWorkMemSize(const Codec& codec, uint32_t threads)
+{
+    if(codec.level != 0)
+    {
+        wfLZ_CompressParams params;
+        wfLZ_CompressParamsInit(&params, codec.level);
+        params.blocks = codec.blocks;
+        return wfLZ_GetWorkMemSizeEx(&params);
+    }
+    if(codec.blockSize != 0 && (codec.blocks != WFLZ_BLOCKS_LONG || codec.filter != WFLZ_FILTER_NONE))
+    {
+        wfLZ_CompressParams params;
+        wfLZ_CompressParamsInit(&params, WFLZ_LEVEL_COMPRESS);
+        params.blocks = codec.blocks;
+        params.filter = codec.filter;
+        return wfLZ_GetWorkMemSizeChunkEx(&params, codec.blockSize, threads);
+    }
+    if(codec.blockSize != 0 && threads != 1)
+        return wfLZ_GetWorkMemSizeParallel(threads);
+    return wfLZ_GetWorkMemSize();
+}
+
+static uint32_t compress(const Codec& codec, const vector<uint8_t>& in, vector<uint8_t>& out, vector<uint8_t>& workMem, uint32_t threads)
+{
+    if(codec.blockSize != 0)
+    {
+        if(codec.blocks != WFLZ_BLOCKS_LONG || codec.filter != WFLZ_FILTER_NONE)
+        {
+            wfLZ_CompressParams params;
+            wfLZ_CompressParamsInit(&params, WFLZ_LEVEL_COMPRESS);
+            params.blocks = codec.blocks;
+            params.filter = codec.filter;
+            return wfLZ_ChunkCompressEx(&in[0], in.size(), codec.blockSize, &out[0], &workMem[0], threads, &params);
+        }
+        if(threads != 1)
+            return wfLZ_ChunkCompressParallel(&in[0], in.size(), codec.blockSize, &out[0], &workMem[0], threads, 0, 0);
+        return wfLZ_ChunkCompress(const_cast<uint8_t*>(&in[0]), in.size(), codec.blockSize, &out[0], &workMem[0], 0, 0);
+    }
+    if(codec.level != 0)
+    {
+        wfLZ_CompressParams params;
+        wfLZ_CompressParamsInit(&params, codec.level);
+        params.blocks = codec.blocks;
+        params.niceLen = codec.niceLen;
+        params.timeLimit = codec.timeLimit;
+        return wfLZ_CompressEx(&in[0], in.size(), &out[0], &workMem[0], &params);
+    }
+    if(codec.fast)
+        return wfLZ_CompressFast(&in[0], in.size(), &out[0], &workMem[0], 0);
+    return wfLZ_Compress(&in[0], in.size(), &out[0], &workMem[0], 0);
+}
+
+static void decompress(const Codec& codec, const vector<uint8_t>& in, vector<uint8_t>& out, uint32_t threads)
+{
+    if(codec.blockSize != 0)
+        wfLZ_ChunkDecompressParallel(&in[0], &out[0], threads);
+    else
+        wfLZ_Decompress(&in[0], &out[0]);
+}
+
+static uint64_t readCycles()
+{
+#ifdef BENCH_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static bool fasterThan(const Timing& a, const Timing& b)
+{
+    return a.seconds < b.seconds;
+}
+
+//The run at percentile p (0-100) of timings sorted fastest first
+static const Timing& percentile(const vector<Timing>& timings, uint32_t p)
+{
+    return timings[(timings.size() - 1) * p / 100];
+}
+
+//Median MB/s, the 10th-90th percentile range of MB/s, and cycles per byte of the median run
+static void printTimings(vector<Timing>& timings, size_t size)
+{
+    sort(timings.begin(), timings.end(), fasterThan);
+    const double mb = size / (1024.0 * 1024.0);
+    ostringstream range;
+    range << fixed << setprecision(0) << mb / percentile(timings, 90).seconds << "-" << mb / percentile(timings, 10).seconds;
+    cout << setw(10) << fixed << setprecision(1) << mb / percentile(timings, 50).seconds << setw(12) << range.str();
+#ifdef BENCH_RDTSC
+    cout << setw(7) << setprecision(2) << (double)percentile(timings, 50).cycles / size;
+#else
+    cout << setw(7) << "-";
+#endif
+}
+
+//Where the output of one CompressEx() call went, from wfLZ_CompressStats
+static void printStats(const Codec& codec, const vector<uint8_t>& in)
+{
+    wfLZ_CompressStats stats;
+    wfLZ_CompressParams params;
+    wfLZ_CompressParamsInit(&params, codec.level != 0 ? codec.level : codec.fast ? WFLZ_LEVEL_FAST : WFLZ_LEVEL_COMPRESS);
+    params.blocks = codec.blocks;
+    params.niceLen = codec.niceLen;
+    params.timeLimit = codec.timeLimit;
+    params.stats = &stats;
+    vector<uint8_t> workMem(wfLZ_GetWorkMemSizeEx(&params));
+    vector<uint8_t> compressed(wfLZ_GetMaxCompressedSize(in.size()));
+    memset(&stats, 0, sizeof(stats));
+    wfLZ_CompressEx(&in[0], in.size(), &compressed[0], &workMem[0], &params);
+    if(stats.numLiterals + stats.matchBytes == 0)
+    {
+        cout << "    no stats, wfLZ.cpp was built without WFLZ_STATS" << endl;
+        return;
+    }
+
+    cout << "    " << stats.numMatches << " matches covering " << stats.matchBytes << " bytes, " << stats.numLiterals << " literals, "
+         << stats.blockOverhead << " bytes of headers and blocks" << endl
+         << "    " << stats.hashLookups << " lookups, " << stats.hashHits << " hits, " << stats.candidates << " candidates, "
+         << stats.hashCollisions << " hash collisions" << endl;
+    if(stats.fastBytes != 0)
+        cout << "    out of time with " << stats.fastBytes << " bytes left, compressed those like level " << WFLZ_LEVEL_FAST << endl;
+    const uint64_t* hists[] = { stats.matchLenHist, stats.matchDistHist };
+    const char* names[] = { "    length   ", "    distance " };
+    for(int h = 0; h < 2; h++)
+    {
+        cout << names[h];
+        for(uint32_t i = 0; i < WFLZ_STATS_HIST_SIZE; i++)
+        {
+            if(hists[h][i] != 0)
+                cout << " " << (1U << i) << "+:" << hists[h][i];
+        }
+        cout << endl;
+    }
+}
+
+static void print_usage()
+{
+    cout << "Usage: wflz_bench [-c codec,...] [-l level] [-r repeats] [-t threads] [-b blocks] [-e niceLen] [-T ms] [-f filter] [-d dir] [-n] [-s] [file1] [file2] ..." << endl
+         << "Compresses and decompresses each file, every file in dir, and built-in synthetic data (unless -n) with each codec," << endl
+         << "checks that it comes back the same, and prints the median MB/s, the 10th-90th percentile range of MB/s" << endl
+         << "and the median cycles per byte (CPU timestamp counter) over the repeats (default 9)" << endl
+         << "  codecs: fast, compress, chunk<KB> (ChunkCompress into blocks of that many KB), level<n> (CompressEx), levels" << endl
+         << "          default fast,compress,chunk16,chunk64,chunk256; -l level is the same as -c level<level>" << endl
+         << "  -t: threads for the chunk codecs (default 1, 0 is one per core)" << endl
+         << "  -b: block format for the level and chunk codecs, long (WFLZ, default), short (WFL3), auto (short for small inputs)" << endl
+         << "      or far (WFLX, matches up to 1MB back -- try it with chunk1024 or bigger)" << endl
+         << "  -e: niceLen for the level codecs, a match this long ends the search (default depends on the level)" << endl
+         << "  -T: time limit in milliseconds for each compression by the level codecs, the rest goes to the fast parser" << endl
+         << "  -f: texture filter for the chunk codecs, none (default), dxt1 or dxt5 (ZLF1 / ZLF5, the blocks are split into planes)" << endl
+         << "  -s: after each row, where the output went: matches, literals, overhead, match finder lookups and the match length" << endl
+         << "      and distance histograms (not for the chunk codecs, needs wfLZ.cpp built with -DWFLZ_STATS)" << endl;
+}
+
+int main(int argc, char** argv)
+{
+    vector<Codec> codecs;
+    vector<Sample> samples;
+    uint32_t repeats = 9;
+    uint32_t threads = 1;
+    bool synthetic = true;
+    bool showStats = false;
+    uint32_t blocks = WFLZ_BLOCKS_LONG;
+    uint32_t niceLen = 0;
+    uint32_t timeLimit = 0;
+    uint32_t filter = WFLZ_FILTER_NONE;
+
+    for(int i = 1; i < argc; i++)
+    {
+        string s = argv[i];
+        if(s == "-c" && i + 1 < argc)
+        {
+            istringstream names(argv[++i]);
+            string name;
+            while(getline(names, name, ','))
+            {
+                if(!parseCodec(name, codecs))
+                {
+                    cerr << "Unknown codec " << name << endl;
+                    return 1;
+                }
+            }
+        }
+        else if(s == "-l" && i + 1 < argc)
+        {
+            if(!parseCodec(string("level") + argv[++i], codecs))
+            {
+                cerr << "No level " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else if(s == "-r" && i + 1 < argc)
+            repeats = atoi(argv[++i]);
+        else if(s == "-t" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(s == "-b" && i + 1 < argc)
+        {
+            string name = argv[++i];
+            if(name == "long")
+                blocks = WFLZ_BLOCKS_LONG;
+            else if(name == "short")
+                blocks = WFLZ_BLOCKS_SHORT;
+            else if(name == "auto")
+                blocks = WFLZ_BLOCKS_AUTO;
+            else if(name == "far")
+                blocks = WFLZ_BLOCKS_FAR;
+            else
+            {
+                cerr << "Unknown block format " << name << endl;
+                return 1;
+            }
+        }
+        else if(s == "-e" && i + 1 < argc)
+            niceLen = atoi(argv[++i]);
+        else if(s == "-T" && i + 1 < argc)
+            timeLimit = atoi(argv[++i]);
+        else if(s == "-f" && i + 1 < argc)
+        {
+            string name = argv[++i];
+            if(name == "none")
+                filter = WFLZ_FILTER_NONE;
+            else if(name == "dxt1")
+                filter = WFLZ_FILTER_DXT1;
+            else if(name == "dxt5")
+                filter = WFLZ_FILTER_DXT5;
+            else
+            {
+                cerr << "Unknown filter " << name << endl;
+                return 1;
+            }
+        }
+        else if(s == "-d" && i + 1 < argc)
+        {
+            if(!loadDir(argv[++i], samples))
+            {
+                cerr << "Unable to read " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else if(s == "-n")
+            synthetic = false;
+        else if(s == "-s")
+            showStats = true;
+        else if(s == "-h" || s == "--help")
+        {
+            print_usage();
+            return 0;
+        }
+        else
+        {
+            Sample sample;
+            sample.name = s;
+            if(!loadFile(s.c_str(), sample.data) || sample.data.empty())
+            {
+                cerr << "Unable to read " << s << endl;
+                return 1;
+            }
+            samples.push_back(sample);
+        }
+    }
+    if(repeats == 0)
+        repeats = 1;
+    if(codecs.empty())
+    {
+        parseCodec("fast", codecs);
+        parseCodec("compress", codecs);
+        parseCodec("chunk16", codecs);
+        parseCodec("chunk64", codecs);
+        parseCodec("chunk256", codecs);
+    }
+    for(size_t c = 0; c < codecs.size(); c++)
+    {
+        codecs[c].blocks = blocks;
+        codecs[c].niceLen = niceLen;
+        codecs[c].timeLimit = timeLimit;
+        codecs[c].filter = filter;
+    }
+    if(synthetic)
+        addSynthetic(samples);
+    if(samples.empty())
+    {
+        cerr << "Nothing to compress" << endl;
+        return 1;
+    }
+
+    cout << "decompressing " << wfLZ_GetCopyWidth() << " bytes at a time, " << repeats << " repeats" << endl;
+    cout << setw(20) << left << "input" << setw(10) << "codec" << right << setw(10) << "size" << setw(9) << "ratio"
+         << setw(10) << "comp MB/s" << setw(12) << "p10-p90" << setw(7) << "c/B"
+         << setw(10) << "dec MB/s" << setw(12) << "p10-p90" << setw(7) << "c/B" << endl;
+
+    for(size_t i = 0; i < samples.size(); i++)
+    {
+        const vector<uint8_t>& in = samples[i].data;
+        vector<uint8_t> decompressed(in.size());
+
+        for(size_t c = 0; c < codecs.size(); c++)
+        {
+            const Codec& codec = codecs[c];
+            vector<uint8_t> compressed(codec.blockSize != 0 ? wfLZ_GetMaxChunkCompressedSize(in.size(), codec.blockSize) : wfLZ_GetMaxCompressedSize(in.size()));
+            vector<uint8_t> workMem(getWorkMemSize(codec, threads));
+            vector<Timing> compTimings, decompTimings;
+            uint32_t compressedSize = 0;
+
+            // one untimed run first, so the timings don't include page faults and clearing workMem
+            fill(decompressed.begin(), decompressed.end(), 0xcd);
+            compress(codec, in, compressed, workMem, threads);
+            decompress(codec, compressed, decompressed, threads);
+
+            for(uint32_t r = 0; r < repeats; r++)
+            {
+                Timing t;
+                uint64_t cycles = readCycles();
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                compressedSize = compress(codec, in, compressed, workMem, threads);
+                t.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                t.cycles = readCycles() - cycles;
+                compTimings.push_back(t);
+
+                cycles = readCycles();
+                start = chrono::steady_clock::now();
+                decompress(codec, compressed, decompressed, threads);
+                t.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                t.cycles = readCycles() - cycles;
+                decompTimings.push_back(t);
+            }
+
+            if(decompressed != in)
+            {
+                cerr << samples[i].name << " " << codec.name << " did not decompress to the original data" << endl;
+                return 1;
+            }
+
+            cout << setw(20) << left << samples[i].name.substr(0, 19) << setw(10) << codec.name << right << setw(10) << compressedSize
+                 << setw(8) << fixed << setprecision(2) << 100.0 * compressedSize / in.size() << "%";
+            printTimings(compTimings, in.size());
+            printTimings(decompTimings, in.size());
+            cout << endl;
+            if(showStats && codec.blockSize == 0)
+                printStats(codec, in);
+        }
+    }
+
+    return 0;
+}